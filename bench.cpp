@@ -0,0 +1,166 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include <sched.h>
+
+#include <bench.hpp>
+#include <cmd_parse.hpp>
+#include <decompress.hpp>
+#include <format.hpp>
+#include <io.hpp>
+#include <phrase_reader.hpp>
+#include <target_read.hpp>
+#include <write_parsing.hpp>
+
+namespace {
+
+/** Pins the calling thread to a core, by default the one it runs on; returns the core */
+int pin_to_core(int core)
+{
+	if (core < 0) {
+		core = sched_getcpu();
+		if (core < 0) {
+			throw std::runtime_error("Cannot get the current core");
+		}
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		throw std::runtime_error(join_s("Cannot pin to core ", core));
+	}
+	return core;
+}
+
+/** The parsing of a compressed file, with the edges of a cost model */
+phrase_list read_parsing(byte *compressed, const cost_model &cm)
+{
+	auto reader = lzopt::get_phrase_reader(compressed);
+	phrase_list to_ret;
+	while (!reader->end()) {
+		std::uint32_t dst, len;
+		reader->next(dst, len);
+		to_ret.push_back(cm.get_edge(dst, len));
+	}
+	return to_ret;
+}
+
+void print_time(const char *what, double nanosecs, size_t text_len)
+{
+	std::cout << what << std::fixed << std::setprecision(3)
+		<< nanosecs / (std::nano::den / std::milli::den) << " msecs ("
+		<< std::setprecision(1) << text_len / nanosecs * std::nano::den / 1e6 << " MB/s)" << std::endl;
+}
+
+}
+
+void bench(const char *tool_name, int argc, char **argv)
+{
+	using std::string;
+	namespace po = boost::program_options;
+	po::options_description desc;
+	po::variables_map vm;
+
+	++argv;
+	--argc;
+
+	auto caption = join_s("Usage: ", tool_name, " [options]");
+	try {
+		desc.add_options()
+				("input-file,i", po::value<string>()->required(),
+				 "Compressed file")
+				("runs,n", po::value<unsigned int>()->default_value(100U),
+				 "Decompressions to be timed")
+				("core", po::value<int>(),
+				 "Core to pin to (default: the one the tool starts on)")
+				("target,t", po::value<string>(),
+				 "Target machine model: prints the time it predicts as well")
+				("prefetch", "Uses the prefetching decoder");
+		po::positional_options_description pd;
+		pd.add("input-file", 1);
+
+		try {
+			po::store(po::command_line_parser(argc, argv).options(desc).positional(pd).run(), vm);
+			po::notify(vm);
+		} catch (boost::program_options::error &e) {
+			throw std::runtime_error(e.what());
+		}
+
+		string infile = vm["input-file"].as<string>();
+		auto runs = vm["runs"].as<unsigned int>();
+		if (runs == 0U) {
+			throw std::runtime_error("Need at least a run");
+		}
+		int core = pin_to_core(vm.count("core") > 0 ? vm["core"].as<int>() : -1);
+
+		// Everything is in memory before the first run
+		auto data = read_file<byte>(infile.c_str(), nullptr, unaligned_io::bit_reader::padding);
+		string enc_name;
+		size_t text_len;
+		byte *parsing;
+		std::tie(enc_name, text_len, parsing) = unpack(data.get());
+		std::unique_ptr<byte[]> output(new byte[text_len + 8]);
+		std::unique_ptr<base_decompress> decompressor;
+		if (vm.count("prefetch") > 0) {
+			dec_fact<fast_copy, prefetch_lookahead> fact;
+			decompressor = encoders_().instantiate<base_decompress, dec_fact<fast_copy, prefetch_lookahead>>(enc_name, fact);
+		} else {
+			dec_fact<fast_copy> fact;
+			decompressor = encoders_().instantiate<base_decompress, dec_fact<fast_copy>>(enc_name, fact);
+		}
+
+		// A first run, not timed, faults the output in
+		decompressor->run(parsing, output.get(), text_len, nullptr);
+		std::vector<double> times(runs);
+		for (auto &time : times) {
+			auto t1 = std::chrono::steady_clock::now();
+			decompressor->run(parsing, output.get(), text_len, nullptr);
+			auto t2 = std::chrono::steady_clock::now();
+			time = std::chrono::duration<double, std::nano>(t2 - t1).count();
+		}
+		std::sort(times.begin(), times.end());
+
+		std::cout << "Encoder: " << enc_name << std::endl;
+		std::cout << "Original size: " << text_len << std::endl;
+		std::cout << "Runs: " << runs << " on core " << core << std::endl;
+		print_time("Min: ", times.front(), text_len);
+		print_time("Median: ", times[(runs - 1) / 2], text_len);
+		// Nearest rank
+		print_time("99th percentile: ", times[static_cast<size_t>(std::ceil(0.99 * runs)) - 1], text_len);
+		if (vm.count("target") > 0) {
+			auto time_cm = get_wm(vm["target"].as<string>().c_str(), enc_name.c_str());
+			print_time("Predicted: ", parsing_length<double>(read_parsing(data.get(), time_cm), time_cm), text_len);
+		}
+	} catch (std::runtime_error e) {
+		std::stringstream ss;
+		ss << e.what() << std::endl;
+		ss << caption << std::endl;
+		ss << desc << std::endl;
+		throw cmd_error(ss.str());
+	}
+}
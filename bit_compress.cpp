@@ -26,6 +26,7 @@
 #include <assert.h>
 #include <cstdint>
 #include <chrono>
+#include <future>
 
 #include <bit_compress.hpp>
 #include <cmd_parse.hpp>
@@ -34,18 +35,19 @@
 #include <utilities.hpp>
 #include <optimal_parser.hpp>
 #include <write_parsing.hpp>
+#include <checksum.hpp>
 #include <model_read.hpp>
 #include <generators.hpp>
 #include <bucket_fsg.hpp>
 #include <meter_printer.hpp>
+#include <memory_planner.hpp>
 #include <type_traits>
 
-void print_solution(const std::vector<edge_t> &sol, cost_model cm)
+void print_solution(const phrase_list &sol, cost_model cm)
 {
-	auto it = sol.begin(), end = std::prev(sol.end(), 1);
-	unsigned int cost = 0U;
+	unsigned int cost = 0U, pos = 0U;
 	std::cout << "Distance\tLength\tEnding Cost\tEnding Position" << std::endl;
-	while (it != end) {
+	for (auto it = sol.begin(); it != sol.end(); ++it) {
 		if (it->kind() == PLAIN) {
 			cost += cm.lit_cost(it->ell);
 			std::cout << "L\t" << it->ell << "\t" << cost;;
@@ -55,8 +57,8 @@ void print_solution(const std::vector<edge_t> &sol, cost_model cm)
 			cost += cm.get_cost(dst_idx, len_idx);
 			std::cout << it->d << "\t" << it->ell << "\t" << cost;
 		}
-		std::advance(it, it->ell);
-		std::cout << "\t" << std::distance(sol.begin(), it) << std::endl;
+		pos += it->ell;
+		std::cout << "\t" << pos << std::endl;
 	}
 }
 
@@ -71,15 +73,16 @@ protected:
 	bool correct_check;
 	bool print_sol;
 	bool use_meter;
+	bool checksums;
 
-	virtual std::tuple<cost_model, size_t> get_model() = 0;
+	virtual std::tuple<cost_model, size_t> get_model(text_info t_info) = 0;
 
 	virtual std::string encoder_name() = 0;
 
-	virtual void write(std::vector<edge_t> &&solution, text_info t_info) = 0;
+	virtual void write(phrase_list &&solution, text_info t_info, const block_checksums &checksums) = 0;
 
 	template <typename fsg_t>
-	std::vector<edge_t> get_solution(
+	phrase_list get_solution(
 		text_info t_info, fsg_t &&fsg, size_t lit_win, cost_model cm, double *cost, bool use_meter
 	)
 	{
@@ -94,10 +97,6 @@ protected:
 	void generic_run()
 	{
 		namespace chr = std::chrono;
-		cost_model cm;
-		size_t lit_win;
-		std::tie(cm, lit_win) = get_model();
-
 		auto file_info = get_file(in_file.c_str());
 		text_info t_info(std::get<0>(file_info), std::get<1>(file_info));
 
@@ -105,11 +104,23 @@ protected:
 			throw std::logic_error("Cowardly refusing to run on an empty file.");
 		}
 
+		cost_model cm;
+		size_t lit_win;
+		std::tie(cm, lit_win) = get_model(t_info);
+
+		// The checksums of the text are computed while parsing
+		std::future<block_checksums> checksums_job;
+		if (checksums) {
+			checksums_job = std::async(
+				std::launch::async, checksum_blocks, t_info.text.get(), t_info.len, checksum_block_size
+			);
+		}
+
 		double cost;
 		std::cout << "Encoder: " << encoder_name() << std::endl;
 		std::cout << "Generator: " << fsg_fact_t::name() << std::endl;
 		auto t1 = chr::high_resolution_clock::now();
-		std::vector<edge_t> solution;
+		phrase_list solution;
 		sa_instantiate sa;
 
 		auto mb_bucket = bucket * 1024 * 1024; // Convert from MBytes in bytes
@@ -141,12 +152,12 @@ protected:
 		if (print_sol) {
 			print_solution(solution, cm);
 		}
-		write(std::move(solution), t_info);
+		write(std::move(solution), t_info, checksums ? checksums_job.get() : block_checksums());
 	}
 
 public:
-	call_func(std::string in_file, std::string out_file, std::string encoder, size_t bucket, bool correct_check, bool print_sol, bool use_meter)
-		: in_file(in_file), out_file(out_file), encoder(encoder), bucket(bucket), correct_check(correct_check), print_sol(print_sol), use_meter(use_meter)
+	call_func(std::string in_file, std::string out_file, std::string encoder, size_t bucket, bool correct_check, bool print_sol, bool use_meter, bool checksums)
+		: in_file(in_file), out_file(out_file), encoder(encoder), bucket(bucket), correct_check(correct_check), print_sol(print_sol), use_meter(use_meter), checksums(checksums)
 	{
 
 	}
@@ -159,7 +170,7 @@ public:
 
 class call_real_func : public call_func {
 protected:
-	std::tuple<cost_model, size_t> get_model() {
+	std::tuple<cost_model, size_t> get_model(text_info t_info) {
 		// The encoder container
 		encoders_ enc_container;
 
@@ -172,7 +183,7 @@ protected:
 		}
 
 		// Get cost model and literal window
-		cost_model cm	= enc_container.get_cm(encoder);
+		cost_model cm	= enc_container.get_cm(encoder, t_info.text.get(), t_info.len);
 		size_t lit_win	= enc_container.get_literal_len(encoder);
 		return std::make_tuple(cm, lit_win);
 	}
@@ -182,14 +193,20 @@ protected:
 		return encoder;
 	}
 
-	void write(std::vector<edge_t> &&solution, text_info t_info) {
-		write_parsing(solution, t_info, out_file, encoder);
+	void write(phrase_list &&solution, text_info t_info, const block_checksums &checksums) {
+		auto comp = write_parsing(solution, t_info, encoder);
+		if (checksums.block_size > 0U) {
+			add_checksums(comp, checksums);
+		}
+		std::ofstream file;
+		open_file(file, out_file.c_str());
+		write_file<byte>(file, comp.data.get(), static_cast<std::streamsize>(comp.total_size));
 	}
 
 public:
 
-	call_real_func(std::string in_file, std::string out_file, std::string encoder, size_t bucket, bool correct_check, bool print_sol, bool use_meter)
-		: call_func(in_file, out_file, encoder, bucket, correct_check, print_sol, use_meter)
+	call_real_func(std::string in_file, std::string out_file, std::string encoder, size_t bucket, bool correct_check, bool print_sol, bool use_meter, bool checksums)
+		: call_func(in_file, out_file, encoder, bucket, correct_check, print_sol, use_meter, checksums)
 	{
 
 	}
@@ -203,7 +220,7 @@ public:
 
 class call_bogus_func : public call_func {
 protected:
-	std::tuple<cost_model, size_t> get_model() {
+	std::tuple<cost_model, size_t> get_model(text_info) {
 		unsigned int lit_win;
 		cost_model cm = read_model(encoder.c_str(), &lit_win);
 		return std::make_tuple(cm, lit_win);
@@ -214,14 +231,14 @@ protected:
 		return join_s("emulated, ", encoder);
 	}
 
-	void write(std::vector<edge_t> &&solution, text_info)
+	void write(phrase_list &&solution, text_info, const block_checksums &)
 	{
 
 	}
 
 public:
 	call_bogus_func(std::string infile, const char *model_name, size_t bucket, bool correct_check, bool print_sol, bool use_meter)
-		: call_func(infile, "", model_name, bucket, correct_check, print_sol, use_meter)
+		: call_func(infile, "", model_name, bucket, correct_check, print_sol, use_meter, false)
 	{
 
 	}
@@ -245,9 +262,11 @@ public:
  *		Generator name
  * @param bucket
  *		Bucket size. 0 = no bucketization.
+ * @param checksums
+ *		Whether to store the checksums of the text
  */
 void call_real(std::string in_file, std::string out_file, std::string encoder, std::string generator,
-			   size_t bucket, bool correct_check, bool print_sol, bool use_meter)
+			   size_t bucket, bool correct_check, bool print_sol, bool use_meter, bool checksums)
 {
 	if (generator.empty()) {
 		auto dst_win = encoders_().get_cm(encoder).get_dst();
@@ -257,7 +276,7 @@ void call_real(std::string in_file, std::string out_file, std::string encoder, s
 	const unsigned int max_try = 2U;
 	for (unsigned int tries = 0U; tries < max_try; tries++) {
 		try {
-			generators_().call(generator, call_real_func(in_file, out_file, encoder, bucket, correct_check, print_sol, use_meter));
+			generators_().call(generator, call_real_func(in_file, out_file, encoder, bucket, correct_check, print_sol, use_meter, checksums));
 			return;
 		} catch (gen_mismatch &e) {
 			std::cerr << e.what() << std::endl;
@@ -335,8 +354,11 @@ void bit_compress(const char *tool_name, int argc, char **argv)
 				 "Picks the generator. Invoke the gens command to list available generators. Selects the best one by default.")
 				("bucket,b", po::value<unsigned int>(),
 				 "Buckets the input. Argument in megabytes.")
+				("max-memory", po::value<string>(),
+				 "Memory budget (append K, M, G or T for kilobytes, megabytes, gigabytes or terabytes). Picks the bucket size, unless given.")
 				("check,c", "Checks if the parsing is correct.")
 				("print-sol,p", "Prints the solution on stdout.")
+				("checksums,k", "Stores the checksums of the text, for decompress --verify")
 				("progress-bar,z", "Prints the progress bar");
 		po::positional_options_description pd;
 		pd.add("input-file", 1).add("out-file", 1).add("encoder", 1);
@@ -368,13 +390,29 @@ void bit_compress(const char *tool_name, int argc, char **argv)
 		if (vm.count("bucket") > 0) {
 			bucket_size = vm["bucket"].as<unsigned int>();
 		}
+		if (vm.count("bucket") == 0 && vm.count("max-memory") > 0) {
+			auto budget = parse_memory_size(vm["max-memory"].as<string>());
+			unsigned int lit_win;
+			auto cm = use_encoder 
+				? encoders_().get_cm(vm["encoder"].as<string>())
+				: read_model(vm["emulate"].as<string>().c_str(), &lit_win);
+			std::ifstream file;
+			open_file(file, infile.c_str());
+			memory_planner planner(file_length(file), cm);
+			const size_t mbyte = 1U << 20;
+			auto bucket = planner.plan_bucket(budget, mbyte);
+			bucket_size = bucket / mbyte;
+			cout 	<< "Memory plan: " 
+					<< (bucket_size > 0U ? join_s("buckets of ", bucket_size, "MB") : std::string("no bucketing"))
+					<< ", estimated " << planner.bucketed(bucket) << endl;
+		}
 
 		bool correct_check = vm.count("check") > 0;
 
 		auto t_start = chr::high_resolution_clock::now();
 		if (use_encoder) {
 			string enc_name = vm["encoder"].as<string>();
-			call_real(infile, outfile, enc_name, gen, bucket_size, correct_check, print_sol, use_meter);
+			call_real(infile, outfile, enc_name, gen, bucket_size, correct_check, print_sol, use_meter, vm.count("checksums") > 0);
 		} else {
 			string model_name = vm["emulate"].as<string>();
 			assert(use_model);
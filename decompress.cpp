@@ -16,25 +16,61 @@
 
 #include <decompress.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 std::uint64_t decompress_file(const char *tool_name, int argc, char **argv, std::ostream &out)
 {
 	argc -= 2;
 	argv += 2;
+	auto usage = join_s(tool_name, " input output [--prefetch] [--verify]");
 	if (argc < 2) {
-		throw cmd_error(join_s(tool_name, " input output"));
+		throw cmd_error(usage);
 	}
 	char *input		= *argv++;
 	char *output	= *argv++;
+	// Decodes copies ahead and prefetches their sources (see decompress)
+	bool prefetch = false;
+	// Checks the text against the checksums of the file
+	bool verify = false;
+	for (int i = 2; i < argc; i++, argv++) {
+		if (std::strcmp(*argv, "--prefetch") == 0) {
+			prefetch = true;
+		} else if (std::strcmp(*argv, "--verify") == 0) {
+			verify = true;
+		} else {
+			throw cmd_error(usage);
+		}
+	}
 
-	size_t file_size;
-	auto data_holder = read_file<byte>(input, &file_size, 8);
-	byte *data = data_holder.get();
+	std::ifstream in_file;
+	open_file(in_file, input);
+	size_t file_size = file_length(in_file);
 
-	dec_output dec_res = decompress_full(data);
+	dec_output dec_res = decompress_in_place(in_file, file_size, prefetch);
 
 	out << "Encoder: " << dec_res.enc_name << std::endl;
 	out << "Decompression time: " << dec_res.dec_time / (std::nano::den / std::milli::den) << " msecs" << std::endl;
 
+	if (verify) {
+		auto &checksums = dec_res.checksums;
+		if (checksums.block_size == 0U) {
+			throw std::runtime_error(join_s(input, " has no checksums"));
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		auto block = first_mismatch(checksums, dec_res.rep.get(), dec_res.uncompressed_size);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		if (block < checksums.sums.size()) {
+			auto start = std::uint64_t(block) * checksums.block_size;
+			throw std::runtime_error(join_s(
+				"Checksum mismatch in block ", block, " (bytes ", start, " to ",
+				std::min<std::uint64_t>(start + checksums.block_size, dec_res.uncompressed_size), ")"
+			));
+		}
+		out << "Verified " << checksums.sums.size() << " checksums in "
+			<< std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " usecs" << std::endl;
+	}
+
 	// Now we should write "uncompressed".
 	std::ofstream out_file;
 	open_file(out_file, output);
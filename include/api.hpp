@@ -18,6 +18,7 @@
 #define __API__
 
 #include <common.hpp>
+#include <cost_model.hpp>
 #include <memory>
 #include <cstdint>
 
@@ -101,6 +102,17 @@ size_t safe_buffer_size(const char *encoder_name, size_t compressed_length);
  */
 std::unique_ptr<byte[]> decompress(byte *compressed, size_t *decompressed_size = nullptr);
 
+/**
+ * Uncompress only the beginning of a compressed buffer (headers + parsing), stopping as soon as
+ * max_bytes bytes are decoded: a phrase crossing that point is decoded in part.
+ * \param 	compressed			Start of compressed buffer
+ * \param 	output				Pointer to start of decompressed data, of at least max_bytes bytes
+ * 								(nothing is written past them)
+ * \param	max_bytes			Bytes to be decoded
+ * \return	Bytes decoded, that is, the least between max_bytes and the uncompressed size
+ */
+size_t decompress_prefix(byte *compressed, byte *output, size_t max_bytes);
+
 /**
  * Compress a text into a raw buffer (i.e., without headers at the beginning)
  * \param 	encoder_name		The integer encoder name (for a list, invoke bc-zip with command "list")
@@ -127,6 +139,69 @@ compress(
 	const char *encoder_name, byte *uncompressed, size_t length, size_t *compressed_length = nullptr
 );
 
+/** What a bound of compress_bounded limits */
+enum bound_kind {
+	/** Decompression time, in nanoseconds, as estimated by the time model */
+	TIME_BOUND,
+	/** Compressed size, in bits */
+	SPACE_BOUND
+};
+
+/**
+ * A bound of compress_bounded, either absolute or relative: a level in [0, 1]
+ * from the fastest (0) to the smallest (1) parsing, for a time bound, or
+ * from the smallest (0) to the fastest (1), for a space bound. These are the
+ * bounds given with options -b and -l of the compress tool.
+ */
+struct compression_bound {
+	bound_kind kind;
+	bool relative;
+	double value;
+
+	static compression_bound time(double nanoseconds)
+	{
+		return {TIME_BOUND, false, nanoseconds};
+	}
+
+	static compression_bound space(double bits)
+	{
+		return {SPACE_BOUND, false, bits};
+	}
+
+	static compression_bound time_level(double level)
+	{
+		return {TIME_BOUND, true, level};
+	}
+
+	static compression_bound space_level(double level)
+	{
+		return {SPACE_BOUND, true, level};
+	}
+};
+
+/**
+ * Compress a text into a full buffer (i.e., WITH headers at the beginning) with the smallest
+ * parsing whose decompression time is within a time bound, or the fastest within a space bound
+ * (bicriteria compression, as the compress tool does).
+ * \param 	encoder_name		The integer encoder name (for a list, invoke bc-zip with command "list")
+ * \param	time_model			Decompression time of the phrases of the encoder on the target machine,
+ 								as the models of a target file (see get_wm and wm_unserialize)
+ * \param	bound				Bound on time or space
+ * \param	uncompressed 		Pointer to data to be compressed
+ * \param	length 				Length of data to be compressed
+ * \param	compressed_length	If not null, will contain the length of compressed output
+ * \param	space				If not null, will contain the length of the parsing, in bits
+ * \param	time				If not null, will contain the estimated decompression time, in nanoseconds
+ * \param	threads				Number of threads parsing the text
+ * \return	Pointer to compressed output
+ */
+std::unique_ptr<byte[]>
+compress_bounded(
+	const char *encoder_name, const cost_model &time_model, compression_bound bound,
+	byte *uncompressed, size_t length, size_t *compressed_length = nullptr,
+	size_t *space = nullptr, double *time = nullptr, unsigned int threads = 1U
+);
+
 /**
  * Extract the header from a full buffer.
  * \param	parsing			Pointer to parsing
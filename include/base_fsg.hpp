@@ -183,6 +183,21 @@ public:
 		return true;
 	}
 
+	/**
+	 * @brief
+	 *		Moves past the next position without generating its maximal edges
+	 *		(as gen_next(), but the text indexes are only kept up to date)
+	 */
+	inline bool skip_next()
+	{
+		if (g.text_pos() >= t_len) {
+			return false;
+		}
+		g.pre_gen();
+		g.post_gen();
+		return true;
+	}
+
 	std::vector<edge_t> &get_edges()
 	{
 		return maxedges;
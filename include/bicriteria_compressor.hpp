@@ -0,0 +1,1035 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __BICRITERIA_COMPRESSOR_HPP
+#define __BICRITERIA_COMPRESSOR_HPP
+
+#include <facilities.hpp>
+#include <cm_factory.hpp>
+#include <write_parsing.hpp>
+#include <parsing_manage.hpp>
+#include <solution_integrator.hpp>
+#include <match_integrator.hpp>
+#include <path_swapper.hpp>
+#include <parse_arena.hpp>
+#include <warm_start.hpp>
+
+#include <cppformat/format.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <ratio>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+enum bound_type {
+	TIME,
+	SPACE
+};
+
+class fixed_bound;
+
+class bound {
+	bound_type bt;
+public:
+
+	bound(bound_type bt) : bt(bt)
+	{
+
+	}
+
+	virtual fixed_bound get_fixed(double max_w, double min_w) = 0;
+
+	bound_type type()
+	{
+		return bt;
+	}
+
+	virtual std::string name() = 0;
+
+	virtual ~bound()
+	{
+
+	}
+};
+
+/** num / den, with prec decimal digits if not an integer */
+std::string prec_print(unsigned int num, unsigned int den, unsigned int prec);
+
+/** Prints numbers on stream with thousands separators, if the en_US.UTF-8 locale is installed */
+void imbue_grouping(std::ostream &stream);
+
+const unsigned int kilo_num = 1024;
+const unsigned int mega_num = 1048576;
+
+class fixed_bound : public bound {
+private:
+	// nanoseconds / bytes
+	double fix_bound;
+
+	std::string space_name(unsigned int value)
+	{
+		if (value < kilo_num) {
+			return join_s(value, "B");
+		} else if (value < mega_num) {
+			return join_s(prec_print(value, 8 * kilo_num, 2), "KB");
+		} else {
+			return join_s(prec_print(value, 8 * mega_num, 2), "MB");
+		}
+	}
+
+	std::string time_name(unsigned int value)
+	{
+		if (value < std::giga::num) {
+			return join_s(value / std::mega::num, "msec");
+		} else {
+			return join_s(prec_print(value, std::giga::num, 2), "sec");
+		}
+	}
+
+public:
+	fixed_bound(bound_type bt, double fix_bound) : bound(bt), fix_bound(fix_bound)
+	{
+
+	}
+
+	fixed_bound get_fixed(double, double)
+	{
+		return *this;
+	}
+
+	double get_bound()
+	{
+		return fix_bound;	
+	}
+
+	std::string name()
+	{
+		switch (type()) {
+		case SPACE:
+			return space_name(fix_bound);
+		default:
+			return time_name(fix_bound);
+		}
+	}
+};
+
+class relative_bound : public bound {
+private:
+	double c_level;
+public:
+	relative_bound(bound_type bt, double c_level) : bound(bt), c_level(c_level)
+	{
+
+	}
+
+	fixed_bound get_fixed(double max, double min)
+	{
+		return fixed_bound(type(), min + c_level * (max - min));
+	}
+
+	std::string name()
+	{
+		switch (type()) {
+		case SPACE:
+			return join_s(c_level, "S");
+		default:
+			return join_s(c_level, "T");
+		}
+	}
+};
+
+/**
+ * When the search of the optimal dual basis stops, short of the optimum.
+ * The deadline only cuts the search: the cost- and weight-optimal
+ * solutions the basis starts from are always computed, and the basis found
+ * is always integrated and swapped, so a compression may end past it.
+ */
+struct search_limits {
+	typedef std::chrono::steady_clock clock;
+
+	/** Wall time of a compression, from its start (zero: no deadline) */
+	std::chrono::milliseconds deadline;
+	/** Relative gap between the bounds on φ */
+	double tolerance;
+
+	search_limits() : deadline(0), tolerance(1e-6)
+	{
+
+	}
+
+	/** Whether a relative gap of delta between the bounds on φ ends the search */
+	bool converged(double delta) const
+	{
+		return !(delta > tolerance);
+	}
+
+	/**
+	 * Whether another iteration as long as iteration_time, from now, would
+	 * end past the deadline of a compression started at start
+	 */
+	bool out_of_time(clock::time_point start, clock::time_point now, clock::duration iteration_time) const
+	{
+		return deadline.count() > 0 && now + iteration_time > start + deadline;
+	}
+};
+
+/** Parses a duration: a number, optionally followed by ms, s, m or h (default s) */
+std::chrono::milliseconds parse_duration(const std::string &param);
+
+enum gen_type {
+	SPACE_OPT,
+	TIME_OPT,
+	LAMBDA
+};
+
+typedef std::tuple<std::string, std::string> gen_info_t;
+
+class solution_info {
+private:
+	double space;
+	double time;
+	bool dual_model;
+	cost_model cm_1;
+	cost_model cm_2;
+public:
+	solution_info()
+	{
+
+	}
+
+	solution_info(double space, double time, cost_model cm)
+		: space(space), time(time), dual_model(false), cm_1(cm)
+	{
+
+	}
+
+	solution_info(double space, double time, cost_model cm_1, cost_model cm_2)
+		: space(space), time(time), dual_model(true), cm_1(cm_1), cm_2(cm_2)
+	{
+
+	}
+
+	double get_space() const
+	{
+		return space;
+	}
+
+	double get_time() const
+	{
+		return time;
+	}
+
+	std::tuple<double, double> get() const
+	{
+		return std::make_tuple(space, time);
+	}
+
+	gen_info_t get_gen_info() const
+	{
+		return std::make_tuple(cm_1.id(), cm_2.id());
+	}
+
+	template <typename sol_get_t>
+	phrase_list generate(sol_get_t &getter) const
+	{
+		if (dual_model) {
+			return getter.fast(cm_1, cm_2);
+		}
+		return getter.fast(cm_1);
+	}
+};
+
+std::ostream &operator<<(std::ostream &stream, const gen_info_t &gen);
+
+std::ostream &operator<<(std::ostream &stream, const solution_info &si);
+
+struct cost_weight {
+	double cost;
+	double weight;
+
+	std::tuple<double, double> get() const
+	{
+		return std::make_tuple(cost, weight);
+	}
+};
+
+class cw_factory {
+private:
+	bool space_is_cost;
+public:
+	cw_factory(bool space_is_cost) : space_is_cost(space_is_cost)
+	{
+
+	}
+
+	cost_weight get(double space, double time) const
+	{
+		if (space_is_cost) {
+			return { space, time };
+		}
+		return {time, space};
+	}
+
+	cost_weight get(const solution_info &si) const
+	{
+		double space, time;
+		std::tie(space, time) = si.get();
+		return get(space, time);
+	}
+};
+
+struct copy_compressed_file {
+	std::shared_ptr<byte> data;
+	// In bits!
+	size_t total_size;
+	// In bits!
+	size_t parsing_size;
+
+	copy_compressed_file()
+	{
+		
+	}
+
+	copy_compressed_file(compressed_file &&to_copy)
+		: 	data(to_copy.data.release(), std::default_delete<byte[]>()),
+			total_size(to_copy.total_size), parsing_size(to_copy.parsing_size)
+	{
+
+	}
+};
+
+class compressed_cache {
+private:
+	std::list<std::tuple<solution_info, copy_compressed_file>> cache_list;
+	size_t capacity;
+
+	bool remove_latest(cw_factory cwf, double W, bool feasible)
+	{
+		for (auto it = cache_list.begin(); it != cache_list.end(); it++) {
+			double weight = cwf.get(std::get<0>(*it)).weight;
+			if ((weight <= W) == feasible) {
+#ifndef NDEBUG
+				std::cerr << "[CACHE] - " << std::get<0>(*it) << std::endl;;
+#endif
+				cache_list.erase(it);
+				return true;
+			}
+		}
+		return false;
+	}
+
+public:
+	compressed_cache(size_t capacity) : capacity(capacity)
+	{
+
+	}
+
+	void add(solution_info si, copy_compressed_file comp, cw_factory cwf, double W)
+	{
+		if (cache_list.size() >= capacity) {
+			auto weight = cwf.get(si).weight;
+			if (!remove_latest(cwf, W, weight <= W)) {
+#ifndef NDEBUG
+				std::cerr << "[CACHE] - " << std::get<0>(cache_list.back()) << std::endl;
+#endif	
+				cache_list.pop_front();
+			}
+		}
+#ifndef NDEBUG
+		std::cerr << "[CACHE] + " << si << std::endl;
+#endif
+		assert(cache_list.size() < capacity);
+		cache_list.push_back(std::make_tuple(si, comp));
+	}
+
+	bool get(gen_info_t gen_info, copy_compressed_file &cc)
+	{
+#ifndef NDEBUG
+		std::cerr << "[CACHE] R:" << gen_info << std::endl;
+#endif
+		for (auto i : cache_list) {
+			gen_info_t this_gi = std::get<0>(i).get_gen_info();
+#ifndef NDEBUG
+			std::cerr << "[CACHE] Considering " << this_gi << std::endl;
+#endif
+			if (this_gi == gen_info) {
+#ifndef NDEBUG
+				std::cerr << "[CACHE] Returning it" << std::endl;
+#endif
+				cc = std::get<1>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+class solution_dual {
+private:
+	double cost;
+	double weight;
+public:
+
+	solution_dual()
+		: cost(std::numeric_limits<double>::max()), weight(std::numeric_limits<double>::max())
+	{
+
+	}
+
+	solution_dual(double cost, double weight, double W)
+		: cost(cost), weight(weight - W)
+	{
+
+	}
+
+	solution_dual(const solution_info &si, cw_factory cwf, double W)
+	{
+		cost_weight cw = cwf.get(si);
+		cost = cw.cost;
+		weight = cw.weight - W;
+	}
+
+	double value(double lambda)
+	{
+		return cost + lambda * weight;
+	}
+
+	bool does_intersect(solution_dual s_2)
+	{
+		return weight != s_2.weight;
+	}
+
+	std::tuple<double, double> intersect(solution_dual s_2)
+	{
+		if (!does_intersect(s_2)) {
+			throw std::logic_error("Intersection of parallel lines requested");
+		}
+		double lambda = (cost - s_2.cost) / (s_2.weight - weight);
+		lambda = std::max<double>(0.0, lambda);
+		double value_  = value(lambda);
+		return std::make_tuple(lambda, value_);
+	}
+
+	bool feasible()
+	{
+		return weight <= 0;
+	}
+};
+
+class dual_basis {
+private:
+	cw_factory cwf;
+	std::tuple<solution_info, solution_dual> left;
+	std::tuple<solution_info, solution_dual> right;
+	double W;
+
+	void update(
+		std::tuple<solution_info, solution_dual> new_left, 
+		std::tuple<solution_info, solution_dual> new_right
+	)
+	{
+		double new_lambda, new_cost;
+		solution_dual s_left = std::get<1>(new_left);
+		solution_dual s_right = std::get<1>(new_right);
+		if (!s_left.does_intersect(s_right)) {
+			std::cerr << "Ooops, this should never happen..." << std::endl;
+			return;
+		}
+		std::tie(new_lambda, new_cost) = s_left.intersect(s_right);
+		double lambda, cost;
+		std::tie(lambda, cost) = current();
+		if (new_cost <= cost) {
+			left = new_left;
+			right = new_right;
+		}
+	}
+
+public:
+	dual_basis(cw_factory cwf, solution_info cost_opt, solution_info weight_opt, double W) 
+		: cwf(cwf), W(W)
+	{
+		left = std::make_tuple(cost_opt, solution_dual(cost_opt, cwf, W));
+		right = std::make_tuple(weight_opt, solution_dual(weight_opt, cwf, W));
+	}
+
+	std::tuple<double, double> current()
+	{
+		return std::get<1>(left).intersect(std::get<1>(right));
+	}
+
+	double lower_envelope(double lambda)
+	{
+		return std::min(
+			std::get<1>(left).value(lambda),
+			std::get<1>(right).value(lambda)
+		);
+	}
+
+	std::tuple<double, double> update(solution_info si)
+	{
+		solution_dual sd(si, cwf, W);
+		auto candidate = std::make_tuple(si, sd);
+		if (sd.feasible()) {
+			update(left, candidate);
+		} else {
+			update(candidate, right);
+		}
+		return current();
+	}
+
+	std::tuple<solution_info, solution_info> get_basis() const
+	{
+		return std::make_tuple(std::get<0>(left), std::get<0>(right));
+	}
+
+
+};
+
+std::ostream &operator<<(std::ostream &stream, const dual_basis &basis);
+
+namespace Color {
+    enum Code {
+        FG_RED      = 31,
+        FG_GREEN    = 32,
+        FG_YELLOW	= 33,
+        FG_BLUE     = 34,
+        FG_DEFAULT  = 39,
+        BG_RED      = 41,
+        BG_GREEN    = 42,
+        BG_BLUE     = 44,
+        BG_DEFAULT  = 49,
+        BOLD		= 1,
+        RESET 		= 0
+    };
+    class Modifier {
+        Code code;
+    public:
+        Modifier(Code pCode) : code(pCode) {}
+        friend std::ostream&
+        operator<<(std::ostream& os, const Modifier& mod) {
+            return os << "\033[" << mod.code << "m";
+        }
+    };
+}
+
+template <typename enc_t, typename sol_getter_t>
+class bicriteria_compressor {
+private:
+	text_info to_compress;
+	sol_getter_t &sg;
+ 	cost_model space_cm;
+	cost_model time_cm;
+	std::map<gen_info_t, solution_info> sol_cache;
+	compressed_cache comp_cache;
+	solution_integrator<> si;
+	/** Buffers of the parses of sg, reused across the iterations */
+	parse_arena arena;
+	search_limits limits;
+	/** Progress messages go here (nullptr: none) */
+	std::ostream *log;
+	/** Where to find (and save) the λs of previous compressions, if any */
+	std::shared_ptr<warm_start_file> warm_start;
+	std::string target;
+
+	compressed_file get_unique_comp(const phrase_list &sol, double &space_length, double &time)
+	{
+		// Gets the parsing_length
+		auto p_len = parsing_length<size_t>(sol, space_cm);
+		// Compress it
+		auto comp = write_parsing<enc_t>(sol, p_len, to_compress);
+		space_length = p_len;
+		time = parsing_length<double>(sol, time_cm);
+		return comp;		
+	}
+
+	copy_compressed_file get_comp(const phrase_list &sol, double &space_length, double &time)
+	{
+		return copy_compressed_file(get_unique_comp(sol, space_length, time));
+	}
+
+	template <typename... Args>
+	void print(const char *format, const Args &... args)
+	{
+		if (log != nullptr) {
+			fmt::print(*log, format, args...);
+		}
+	}
+
+	void print_basis(const dual_basis &basis)
+	{
+		if (log != nullptr) {
+			*log << basis << std::endl;
+		}
+	}
+
+	gen_info_t get_gen_info(cost_model cm_1, cost_model cm_2 = cost_model())
+	{
+		return std::make_tuple(cm_1.id(), cm_2.id());
+	}
+
+	/** Those solutions automatically append to the caches */
+	solution_info optimal(cost_model cm_1, cost_model cm_2, bool feasible)
+	{
+		// See if it's cached
+		auto gen_info = get_gen_info(cm_1, cm_2);
+		if (sol_cache.count(gen_info) == 0) {
+			// Gets the solution
+			auto sol = sg.fast(cm_1, cm_2);
+			// Compress that solution and put it into the caches
+			double space, time;
+			auto compressed = get_comp(sol, space, time);
+			arena.recycle(std::move(sol));
+			solution_info si(space, time, cm_1, cm_2);
+			assert(si.get_gen_info() == gen_info);
+			double fake_W = feasible ? std::numeric_limits<double>::max() : 0.0;
+			comp_cache.add(si, compressed, cw_factory(false), fake_W);
+			sol_cache[gen_info] = si;
+		}
+		auto to_ret = sol_cache[gen_info];
+#ifndef NDEBUG
+		std::cerr 	<< "Requested dual-optimal solution; " << to_ret << std::endl;
+#endif
+		return to_ret;
+	}
+
+	solution_info optimal(cost_model cm, cw_factory cwf, double W)
+	{
+		auto gen_info = get_gen_info(cm);
+		if (sol_cache.count(gen_info) == 0) {
+			// Gets the solution
+			auto sol = sg.fast(cm);
+			// Compress the solution and put it into the caches
+			double space, time;
+			auto compressed = get_comp(sol, space, time);
+			arena.recycle(std::move(sol));
+			solution_info si(space, time, cm);
+			assert(si.get_gen_info() == gen_info);
+			comp_cache.add(si, compressed, cwf, W);
+			sol_cache[gen_info] = si;
+		}
+		auto to_ret = sol_cache[gen_info];
+#ifndef NDEBUG
+		std::cerr 	<< "Requested dual-optimal solution; " << to_ret << std::endl;
+#endif
+		return to_ret;
+	}
+
+	dual_basis get_basis(cw_factory cwf, solution_info cost_opt, solution_info weight_opt, double W)
+	{
+		dual_basis to_ret(cwf, cost_opt, weight_opt, W);
+		for (auto i : sol_cache) {
+			auto si = i.second;
+			to_ret.update(si);
+		}
+		return to_ret;
+	}
+
+	compressed_file writable_solution(cost_model cm, size_t *space_ptr = nullptr, double *time_ptr = nullptr)
+	{
+		// Get a full-fledged solution: it is the last parse of the run
+		auto sol = sg.full(cm);
+		arena.release();
+		// Compress it 
+		double space, time;
+		auto to_ret = get_unique_comp(sol, space, time);
+		if (space_ptr != nullptr) {
+			*space_ptr = parsing_length<size_t>(sol, space_cm);
+		}
+		if (time_ptr != nullptr) {
+			*time_ptr = parsing_length<double>(sol, time_cm);
+		}
+
+		return to_ret;
+	}
+
+	copy_compressed_file writable_parsing(solution_info si)
+	{
+		auto sol = si.generate(sg);
+		double space, time;
+		auto to_ret = get_comp(sol, space, time);
+		arena.recycle(std::move(sol));
+		return to_ret;
+	}
+
+	std::vector<shared_parsing> writable_parsings(solution_info s1, solution_info s2)
+	{
+		copy_compressed_file cc_1, cc_2;
+		auto found_1 = comp_cache.get(s1.get_gen_info(), cc_1);
+		auto found_2 = comp_cache.get(s2.get_gen_info(), cc_2);
+		if (!found_1) {
+			std::cerr << "WARNING: left not cached!" << std::endl;
+			cc_1 = writable_parsing(s1);
+		}
+		if (!found_2) {
+			std::cerr << "WARNING: right not cached!" << std::endl;
+			cc_2 = writable_parsing(s2);
+		}
+
+		// We must integrate those parsings
+		auto p_1 = get_parsing(cc_1.data.get(), cc_1.total_size);
+		auto p_2 = get_parsing(cc_2.data.get(), cc_2.total_size);
+		parsing n_1, n_2;
+		auto d_1 = dup_parsing(p_1, n_1);
+		auto d_2 = dup_parsing(p_2, n_2);
+		std::vector<parsing> in = {p_1, p_2};
+		std::vector<parsing> out = {n_1, n_2};
+		if (sg.warm()) {
+			// Parsings of the cached graph: find their distances on the suffix array
+			match_integrator mi(to_compress, sg.suffix_arrays(), space_cm);
+			integrate<enc_t>(in, out, mi);
+		} else {
+			integrate<enc_t>(in, out, si);
+		}
+		return {
+			shared_parsing(d_1, n_1.comp_len, n_1.orig_len), 
+			shared_parsing(d_2, n_2.comp_len, n_2.orig_len)
+		};
+	}
+
+	copy_compressed_file cached_solution(solution_info si)
+	{
+		copy_compressed_file cc;
+		auto found = comp_cache.get(si.get_gen_info(), cc);
+		if (!found) {
+			cc = si.generate(sg);
+		}
+		return cc;
+	}
+
+	solution_integrator<> get_si()
+	{
+		// Shares the suffix array of the solution getter rather than sorting again
+		return solution_integrator<>(gen_ffsg_fact(to_compress, sg.suffix_arrays()), space_cm);
+	}
+
+	/**
+	 * Distances of the cached graph are those of their classes, so repeated
+	 * copies cannot be told apart: they are priced as regular ones, an upper
+	 * bound of their cost.
+	 */
+	cost_model fuse_cm(cost_model to_fuse, cost_model fused_with)
+	{
+		cm_factory cmf(to_fuse, fused_with);
+		auto fused = cmf.cost();
+		fused.set_rep_costs(std::vector<double>());
+		return fused;
+	}
+
+	std::tuple<double, double> max_cost_weight(cw_factory cwf)
+	{
+		auto max_dst = space_cm.get_dst().back();
+		auto max_len = space_cm.get_len().back();
+		// Heaviest copy edges
+		edge_t heaviest_edge_space = space_cm.get_edge(max_dst, max_len);
+		edge_t heaviest_edge_time = time_cm.get_edge(max_dst, max_len);
+		// Single literal edge
+		edge_t lit_edge(1);
+		auto max_space = std::max(
+			space_cm.edge_cost(heaviest_edge_space),
+			space_cm.edge_cost(lit_edge)
+		);
+		auto max_time = std::max(
+			time_cm.edge_cost(heaviest_edge_time),
+			time_cm.edge_cost(lit_edge)
+		);
+		auto max_cw = cwf.get(max_space, max_time);
+		return max_cw.get();
+	}
+
+	phrase_list path_swap(
+		shared_parsing left, solution_info left_si, 
+		shared_parsing right, solution_info right_si,
+		double W, cw_factory cwf, cm_factory cmf, double *cost = nullptr
+	)
+	{
+		double max_cost, max_weight;
+		std::tie(max_cost, max_weight) = max_cost_weight(cwf);
+		W += 2 * max_weight;
+
+		double space_1, time_1, space_2, time_2;
+		std::tie(space_1, time_1) = left_si.get();
+		std::tie(space_2, time_2) = right_si.get();
+		double cost_1, weight_1, cost_2, weight_2;
+		std::tie(cost_1, weight_1) = cwf.get(space_1, time_1).get();
+		std::tie(cost_2, weight_2) = cwf.get(space_2, time_2).get();
+
+		path_swapper<enc_t> swapper(
+			left.get_parsing(), cost_1, weight_1,
+			right.get_parsing(), cost_2, weight_2,
+			cmf.cost(), cmf.weight()
+		);
+
+		return swapper.swap(W, cost);
+	}
+
+	shared_parsing shared_parsing_from_pack(pack_info &&pi)
+	{
+		std::shared_ptr<byte> shared_parsing_ptr(pi.parsing.release(), std::default_delete<byte[]>());
+		byte *ptr = shared_parsing_ptr.get();
+		std::string enc_name;
+		size_t orig_length;
+		byte *start;
+		std::tie(enc_name, orig_length, start) = unpack(ptr);
+		assert(enc_name == enc_t::name());
+		auto comp_len = pi.data_len - (start - ptr);
+		return shared_parsing(shared_parsing_ptr, ptr, comp_len, orig_length);
+	}
+
+public:
+	bicriteria_compressor(
+		text_info to_compress, sol_getter_t &sg,
+		cost_model space_cm, cost_model time_cm, size_t cache_size = 3,
+		search_limits limits = search_limits()
+	) : to_compress(to_compress), sg(sg), space_cm(fuse_cm(space_cm, time_cm)), 
+		time_cm(fuse_cm(time_cm, space_cm)), comp_cache(cache_size), si(get_si()), limits(limits), log(&std::cout)
+	{
+		sg.use_arena(&arena);
+	}
+
+	~bicriteria_compressor()
+	{
+		sg.use_arena(nullptr);
+	}
+
+	/** Sends progress messages to log (nullptr: none) */
+	void set_log(std::ostream *log)
+	{
+		this->log = log;
+	}
+
+	/** Starts from the λs saved in file by a compression towards target, and saves them */
+	void use_warm_start(std::shared_ptr<warm_start_file> file, std::string target)
+	{
+		warm_start = file;
+		this->target = target;
+	}
+
+	compressed_file run(std::shared_ptr<bound> bound_cmp, bool correct_check, size_t *space, double *time = nullptr)
+	{
+		typedef search_limits::clock clock;
+		auto start = clock::now();
+
+		// Instantiate the factories
+		cw_factory cwf(bound_cmp->type() == TIME);
+		cm_factory cmf;
+		if (bound_cmp->type() == TIME) {
+			// Bound on time: time is weight, space is cost
+			cmf = cm_factory(space_cm, time_cm);
+		} else {
+			// Bound on space: space is weight, time is cost
+			cmf = cm_factory(time_cm, space_cm);
+		}
+
+		Color::Modifier red(Color::FG_RED);
+		Color::Modifier green(Color::FG_GREEN);
+		Color::Modifier yellow(Color::FG_YELLOW);
+		Color::Modifier def(Color::RESET);
+		Color::Modifier bold(Color::BOLD);
+
+
+		// Obtain cost-optimal solution
+		print("Getting cost-optimal solution\n");
+		// auto t_1 = std::chrono::high_resolution_clock::now();
+		// auto sol_info_cost = optimal(cmf.cost(), cmf.weight(), false);
+		// auto t_2 = std::chrono::high_resolution_clock::now();
+
+		solution_info sol_info_cost, sol_info_weight;
+		std::chrono::seconds::rep measured_time;
+
+		std::tie(measured_time, sol_info_cost) = measure<std::chrono::seconds>::execution([&]{
+			return optimal(cmf.cost(), cmf.weight(), false);
+		});
+		print("Elapsed time = {}{}{} secs{}\n", bold, yellow, measured_time, def);
+		print("Cost-optimal = {}\n", sol_info_cost);
+
+		// std::cout << "Elapsed time = " 
+		//   << bold << yellow << std::chrono::duration_cast<std::chrono::seconds>(t_2 - t_1).count() << " secs" 
+		//   << def << std::endl;
+
+
+		print("Getting weight-optimal solution\n");
+		// t_1 = std::chrono::high_resolution_clock::now();
+		// auto sol_info_weight = optimal(cmf.weight(), cmf.cost(), true);
+		// t_2 = std::chrono::high_resolution_clock::now();
+
+		std::tie(measured_time, sol_info_weight) = measure<std::chrono::seconds>::execution([&]{
+			return optimal(cmf.weight(), cmf.cost(), true);
+		});
+		print("Elapsed time = {}{}{} secs{}\n", bold, yellow, measured_time, def);
+		print("Weight-optimal = {}\n", sol_info_weight);
+
+		// std::cout << "Elapsed time = " 
+		//   << bold << yellow << std::chrono::duration_cast<std::chrono::seconds>(t_2 - t_1).count() << " secs" 
+		//   << def << std::endl;
+
+		double min_weight = cwf.get(sol_info_weight).weight;
+		double max_weight = cwf.get(sol_info_cost).weight;
+		auto fix_bound = bound_cmp->get_fixed(max_weight, min_weight);
+		double W = fix_bound.get_bound();
+
+		if (log != nullptr) {
+			imbue_grouping(*log);
+		}
+		print("Setting W = {0}{1}{2:.2f}{3} ({4})\n", bold, green, W, def, fix_bound.name());
+
+		// std::cout.precision(2);
+		// std::cout << "Setting W = " << std::fixed << bold << green << W << def << " ("  << fix_bound.name() << ")" << std::endl;
+
+		// Early returns
+		if (W >= max_weight) {
+			return writable_solution(cmf.cost(), space, time);
+		} else if (W == min_weight) {
+			return writable_solution(cmf.weight(), space, time);
+		} else if (W < min_weight){
+			throw std::logic_error("Bound less than weight-optimal solution, problem is unfeasible");
+		}
+
+		// Initialize the basis
+		dual_basis basis = get_basis(cwf, sol_info_cost, sol_info_weight, W);
+
+		print_basis(basis);
+
+		// λ of the solutions found by the search
+		std::map<gen_info_t, double> lambdas;
+		clock::duration iteration_time(0);
+		// Stop if another iteration, as long as the last one, would miss the deadline
+		auto out_of_time = [&](clock::time_point now) {
+			return limits.out_of_time(start, now, iteration_time);
+		};
+
+		// Solve first for the λs of the basis of a previous compression
+		warm_start_entry warm;
+		if (warm_start && warm_start->find(bound_cmp->name(), enc_t::name(), target, &warm)) {
+			for (auto lambda : {warm.left_lambda, warm.right_lambda}) {
+				auto t_0 = clock::now();
+				if (lambda < 0 || out_of_time(t_0)) {
+					continue;
+				}
+				auto si = optimal(cmf.lambda(lambda), cwf, W);
+				lambdas[si.get_gen_info()] = lambda;
+				basis.update(si);
+				iteration_time = clock::now() - t_0;
+				print("Warm start: λ = {0}\n", lambda);
+				print_basis(basis);
+			}
+		}
+
+		// Find the optimal, dual basis, or the best one within the limits
+		double phi_b, phi_bp, delta = std::numeric_limits<double>::max();
+
+		while (!limits.converged(delta)) {
+			auto t_0 = clock::now();
+			if (out_of_time(t_0)) {
+				print("{}{}Deadline reached{}: keeping the current basis\n", bold, red, def);
+				break;
+			}
+			double lambda;
+			// (1) Find optimal (λ, φ)
+			std::tie(lambda, phi_b) = basis.current();
+
+			// (2) Solve for λ
+			solution_info si;
+			std::tie(measured_time, si) = measure<std::chrono::seconds>::execution([&]{
+				return optimal(cmf.lambda(lambda), cwf, W);
+			});
+			lambdas[si.get_gen_info()] = lambda;
+
+			// (3) Update basis
+			basis.update(si);
+
+			// (4) Evaluate basis at current λ
+			phi_bp = basis.lower_envelope(lambda);
+			delta = std::abs(phi_b - phi_bp) / phi_bp;
+
+
+			print("λ = {0}, φ = {1}{2}{3:.12f}{4}, φ' = {5}{6}{7:.12f}{8}, Δ = {9:.9f}\n",lambda, bold, green, phi_b, def, bold, green, phi_bp, def, delta);
+			print_basis(basis);
+			print("Iteration time = {}\n", measured_time, si);
+			iteration_time = clock::now() - t_0;
+		}
+
+		// Integrate the basis
+		print("Integrating base\n");
+		solution_info left, right;
+		std::tie(left, right) = basis.get_basis();
+		if (warm_start) {
+			warm.bound = bound_cmp->name();
+			warm.encoder = enc_t::name();
+			warm.target = target;
+			warm.lambda = std::get<0>(basis.current());
+			auto left_it = lambdas.find(left.get_gen_info()), right_it = lambdas.find(right.get_gen_info());
+			warm.left_lambda = left_it != lambdas.end() ? left_it->second : -1.0;
+			warm.right_lambda = right_it != lambdas.end() ? right_it->second : -1.0;
+			std::tie(warm.left_space, warm.left_time) = left.get();
+			std::tie(warm.right_space, warm.right_time) = right.get();
+			warm_start->store(warm);
+		}
+
+		// t_1 = std::chrono::high_resolution_clock::now();
+		// auto base_parsings = writable_parsings(left, right);
+		// t_2 = std::chrono::high_resolution_clock::now();
+
+		// At most two more parses, which are usually cached: hand the buffers back
+		arena.release();
+		std::vector<shared_parsing> base_parsings;
+		std::tie(measured_time, base_parsings) = measure<std::chrono::seconds>::execution([&]{
+			return writable_parsings(left, right);
+		});
+
+		print("Elapsed time = {}{}{} secs{}\n", bold, yellow, measured_time, def);
+
+		// Path-swap
+		print("Swapping the base\n");
+		auto t_1 = std::chrono::high_resolution_clock::now();
+		auto swapped_sol = path_swap(base_parsings[0], left, base_parsings[1], right, W, cwf, cmf);
+		auto t_2 = std::chrono::high_resolution_clock::now();
+		measured_time = std::chrono::duration_cast<std::chrono::seconds>(t_2 - t_1).count();
+
+		print("Elapsed time = {}{}{} secs{}\n", bold, yellow, measured_time, def);
+
+		if (correct_check) {
+			correctness_report report = check_correctness(swapped_sol, to_compress.text.get());
+			if (!report.correct) {
+				throw std::logic_error(join_s(
+					"Incorrect parsing: position ", report.error_position,
+					", distance ", report.error_d,
+					", length ", report.error_ell
+				));
+			}
+		}
+
+		if (space != nullptr) {
+			*space = parsing_length<size_t>(swapped_sol, space_cm);
+		}
+		if (time != nullptr) {
+			*time = parsing_length<double>(swapped_sol, time_cm);
+		}
+
+		// Compress and return it
+		return  write_parsing(swapped_sol, to_compress, enc_t::name(), space_cm);
+	}
+
+};
+
+#endif
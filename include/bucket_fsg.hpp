@@ -17,50 +17,122 @@
 #ifndef BUCKET_FSG_HPP
 #define BUCKET_FSG_HPP
 
+#include <deque>
+#include <future>
+
 #include <common.hpp>
 #include <utilities.hpp>
 
 
+/**
+ * Splits the text in buckets of bucket_size bytes, each one parsed with its
+ * own generator. Every bucket is generated together with a history window of
+ * (at most) window bytes preceding it, so that maximal edges may reference
+ * data in the previous bucket. The generator only moves past the history
+ * positions (see fsg_protocol::skip_next()): its suffix array and RSAs cover
+ * the history, but maximal edges are generated for the bucket only.
+ *
+ * The generators of the next in_flight buckets (SA, RSA and history skip) are
+ * built on helper threads while the current bucket is being parsed. When
+ * in_flight > 1 the sa_getter must be safe to call concurrently. With
+ * in_flight = 0 every generator is built by the parsing thread, when its
+ * bucket is reached.
+ */
 template <typename gen_fact>
 class bucket_fsg {
 private:
+	typedef std::shared_ptr<typename gen_fact::fsg_t> gen_ptr;
+
 	size_t bucket_size;
+	size_t window;
+	size_t in_flight;
 	unsigned int bucket_idx;
 	text_info ti;
 	sa_getter &sa_cache;
-	std::shared_ptr<typename gen_fact::fsg_t> gen;
+	gen_ptr gen;
 	cost_model cm;
 	std::vector<edge_t> maxedges;
+	std::deque<std::future<gen_ptr>> pending;
+
+	static gen_ptr build(text_info ti, sa_getter *sa_cache, cost_model cm, size_t begin, size_t bucket_size, size_t window)
+	{
+		size_t history = std::min(window, begin);
+		byte *start = ti.text.get() + begin - history;
+		size_t len = history + std::min(bucket_size, ti.len - begin);
+#ifndef NDEBUG
+		std::cout << "Bucket length: " << len << " (history: " << history << ")" << std::endl;
+#endif
+		std::shared_ptr<byte> text(start, null_deleter<byte>());
+		text_info new_ti(text, len);
+		auto new_gen = gen_fact(new_ti, *sa_cache).instantiate(cm);
+		// Positions in the history window belong to the previous bucket
+		for (size_t i = 0; i < history; ++i) {
+			new_gen->skip_next();
+		}
+		return new_gen;
+	}
+
+	void launch()
+	{
+		size_t next_idx = bucket_idx + pending.size();
+		while (pending.size() < in_flight && next_idx * bucket_size < ti.len) {
+			pending.push_back(std::async(
+				std::launch::async, &bucket_fsg::build, ti, &sa_cache, cm, next_idx * bucket_size, bucket_size, window
+			));
+			++next_idx;
+		}
+	}
 
 	bool next_gen()
 	{
 #ifndef NDEBUG
 		std::cout << "Generating bucket " << bucket_idx << std::endl;
 #endif
-		if (bucket_idx * bucket_size >= ti.len) {
+		if (in_flight == 0U) {
+			if (bucket_idx * bucket_size >= ti.len) {
+				return false;
+			}
+			gen = build(ti, &sa_cache, cm, bucket_idx * bucket_size, bucket_size, window);
+			bucket_idx++;
+			return true;
+		}
+		launch();
+		if (pending.empty()) {
 			return false;
 		}
-		byte *start = ti.text.get() + bucket_size * bucket_idx;
-		size_t len = std::min(bucket_size, ti.len - bucket_size * bucket_idx);
-#ifndef NDEBUG
-		std::cout << "Bucket length: " << len << std::endl;
-#endif
-		std::shared_ptr<byte> text(start, null_deleter<byte>());
-		text_info new_ti(text, len);
-		auto new_gen = gen_fact(new_ti, sa_cache).instantiate(cm);
+		auto new_gen = pending.front().get();
+		pending.pop_front();
 		std::swap(gen, new_gen);
 		bucket_idx++;
+		// Start building the following buckets before parsing this one
+		launch();
 		return true;
 	}
 
 public:
-	bucket_fsg(text_info ti, sa_getter &sa_cache, size_t bucket_size, cost_model cm)
-		: bucket_size(bucket_size), bucket_idx(0U), ti(ti), sa_cache(sa_cache), cm(cm)
+	/**
+	 * @param window
+	 *		Length of the history window. Distances never exceed the largest
+	 *		cost class, so by default the window is min(bucket_size, max distance).
+	 * @param in_flight
+	 *		Maximum number of buckets built ahead of the current one, on helper
+	 *		threads. 0 = build each bucket on the parsing thread.
+	 */
+	bucket_fsg(text_info ti, sa_getter &sa_cache, size_t bucket_size, cost_model cm, size_t window, size_t in_flight = 1U)
+		: bucket_size(bucket_size), window(window), in_flight(in_flight), bucket_idx(0U), ti(ti), sa_cache(sa_cache), cm(cm)
 	{
 		next_gen();
 		maxedges.resize(gen->get_edges().size());
 	}
 
+	bucket_fsg(text_info ti, sa_getter &sa_cache, size_t bucket_size, cost_model cm)
+		: bucket_fsg(ti, sa_cache, bucket_size, cm, std::min<size_t>(bucket_size, cm.get_dst().back()))
+	{
+
+	}
+
+	bucket_fsg(bucket_fsg &&) = default;
+
 	std::vector<edge_t> &get_edges()
 	{
 		return maxedges;
@@ -0,0 +1,66 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __CHECKSUM_HPP
+#define __CHECKSUM_HPP
+
+#include <common.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Default bytes of text covered by a checksum */
+const std::uint32_t checksum_block_size = 1U << 16;
+
+/**
+ * CRC32C (Castagnoli) of data[0, len), with the SSE4.2 crc32 instruction
+ * when the CPU has it (detected once), with a table otherwise
+ */
+std::uint32_t crc32c(const byte *data, size_t len);
+
+/** Checksums of the blocks of a text, stored after the parsing (see format.hpp) */
+struct block_checksums {
+	/** Bytes of every block but the last, 0 if there are no checksums */
+	std::uint32_t block_size;
+	std::vector<std::uint32_t> sums;
+
+	block_checksums() : block_size(0U)
+	{
+
+	}
+
+	/** Number of blocks of a text of len bytes */
+	static size_t blocks(size_t len, std::uint32_t block_size)
+	{
+		return block_size == 0U ? 0U : (len + block_size - 1) / block_size;
+	}
+};
+
+/**
+ * The CRC32C of every block_size bytes of text[0, len). Blocks are
+ * independent, so that three of them are hashed at once.
+ */
+block_checksums checksum_blocks(const byte *text, size_t len, std::uint32_t block_size = checksum_block_size);
+
+/**
+ * The first block of text[0, len) not matching its checksum (there must be
+ * some), checksums.sums.size() if none
+ */
+size_t first_mismatch(const block_checksums &checksums, const byte *text, size_t len);
+
+#endif
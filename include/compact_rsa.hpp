@@ -0,0 +1,273 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __COMPACT_RSA_HPP
+#define __COMPACT_RSA_HPP
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+#include <assert.h>
+
+/**
+ * An RSA block storing its (position, rank) entries in a bit-packed form,
+ * as a drop-in replacement of rsa<std::tuple<T,T>> in rsa_queue.
+ *
+ * Entries of a block are sorted by rank and their positions fall in the
+ * range of the block, so:
+ * - ranks are Elias-Fano coded: the low bits go in a fixed-width field,
+ *   the high bits in unary in a bitmap;
+ * - positions are stored in the same field, relative to the first position
+ *   of the block.
+ * This takes about log(text length) + 2 bits per entry instead of 64.
+ *
+ * Blocks are filled sequentially by set() and read by forward iterators
+ * yielding entries by value. Copies share the storage, as rsa does.
+ */
+template <typename T>
+class compact_rsa {
+public:
+	typedef std::uint64_t unit_type;
+	typedef std::tuple<T,T> value_type;
+
+private:
+	/** Layout of a block of a given capacity over a given universe */
+	struct layout {
+		unsigned int low_bits;
+		unsigned int pos_bits;
+		size_t field_units;
+		size_t high_units;
+
+		layout(size_t capacity, size_t universe)
+		{
+			low_bits = universe > capacity ? bit_width(universe / capacity) - 1 : 0U;
+			pos_bits = capacity > 1 ? bit_width(capacity - 1) : 0U;
+			assert(low_bits + pos_bits <= 57);
+			field_units = (capacity * (low_bits + pos_bits) + 63) / 64;
+			high_units = (capacity + (universe >> low_bits) + 1 + 63) / 64;
+		}
+
+		/** Fields, a padding unit for reads across units, high bitmap */
+		size_t units() const
+		{
+			return field_units + 1 + high_units;
+		}
+	};
+
+	static unsigned int bit_width(size_t x)
+	{
+		return x == 0 ? 0U : 64U - __builtin_clzll(x);
+	}
+
+	unit_type *fields_;
+	unit_type *high_;
+	size_t capacity_;
+	size_t units_;
+	unsigned int low_bits_;
+	unsigned int pos_bits_;
+	unsigned int level_;
+	unsigned int start_;
+	unsigned int term_;
+	/** Position the stored positions are relative to */
+	unsigned int base_;
+	size_t size_;
+	/** Entries set so far */
+	size_t filled_;
+	/** Bit of the last entry in the high bitmap */
+	size_t last_high_;
+
+	template <typename Iter>
+	compact_rsa(Iter it, unsigned int level, size_t capacity, size_t universe)
+		: capacity_(capacity), level_(level), start_(0U)
+	{
+		layout l(capacity, universe);
+		fields_ = &(*it);
+		high_ = fields_ + l.field_units + 1;
+		units_ = l.units();
+		low_bits_ = l.low_bits;
+		pos_bits_ = l.pos_bits;
+		resize(capacity);
+	}
+
+	/**
+	 * Fields are at most 57 bits wide: any of them is within an unaligned
+	 * 64-bit load (assumes a little-endian target)
+	 */
+	static std::uint64_t read_field(const unit_type *words, size_t bit, unsigned int width)
+	{
+		std::uint64_t value;
+		std::memcpy(&value, reinterpret_cast<const char*>(words) + (bit >> 3), sizeof(value));
+		return (value >> (bit & 7U)) & ((std::uint64_t(1) << width) - 1);
+	}
+
+public:
+
+	class iterator : public boost::iterator_facade<iterator, value_type, boost::forward_traversal_tag, value_type> {
+	private:
+		friend class boost::iterator_core_access;
+
+		// Copied from the block, to keep them in registers while merging
+		const unit_type *fields;
+		const unit_type *high_words;
+		unsigned int low_bits;
+		unsigned int width;
+		unsigned int base;
+		size_t size;
+		size_t idx;
+		/** First bit of the field of idx */
+		size_t field_bit;
+		/** Word of the high bitmap being scanned, and its bits not consumed yet */
+		size_t word;
+		std::uint64_t bits;
+		value_type current;
+
+		/** Decodes the entry idx, whose high bit is the next one set */
+		void load()
+		{
+			while (bits == 0) {
+				bits = high_words[++word];
+			}
+			std::uint64_t high = (word << 6) + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			auto field = read_field(fields, field_bit, width);
+			auto low = field & ((std::uint64_t(1) << low_bits) - 1);
+			auto rank = ((high - idx) << low_bits) | low;
+			auto pos = base + (field >> low_bits);
+			current = value_type(static_cast<T>(pos), static_cast<T>(rank));
+		}
+
+		void increment()
+		{
+			field_bit += width;
+			if (++idx < size) {
+				load();
+			}
+		}
+
+		bool equal(const iterator &other) const
+		{
+			return idx == other.idx;
+		}
+
+		value_type dereference() const
+		{
+			return current;
+		}
+
+	public:
+		iterator() : fields(nullptr), high_words(nullptr), low_bits(0), width(0), base(0), size(0), idx(0), field_bit(0), word(0), bits(0) { }
+
+		iterator(const compact_rsa &block, size_t idx)
+			: fields(block.fields_), high_words(block.high_), low_bits(block.low_bits_),
+			  width(block.low_bits_ + block.pos_bits_), base(block.base_), size(block.size_), idx(idx), field_bit(0), word(0), bits(0)
+		{
+			if (idx < size) {
+				assert(idx == 0);
+				bits = high_words[0];
+				load();
+			}
+		}
+	};
+
+	/** Returns an empty RSA (which should not be resized!) */
+	compact_rsa()
+		: fields_(nullptr), high_(nullptr), capacity_(0), units_(0), low_bits_(0), pos_bits_(0),
+		  level_(0), start_(0), term_(0), base_(0), size_(0), filled_(0), last_high_(0)
+	{
+
+	}
+
+	/** Storage units taken by a block of the given capacity, whose ranks are below universe */
+	static size_t units(size_t capacity, size_t universe)
+	{
+		return layout(capacity, universe).units();
+	}
+
+	/** Lays a block over the storage starting from it (see units()) */
+	template <typename Iter>
+	static compact_rsa make(Iter it, unsigned int level, size_t capacity, size_t universe)
+	{
+		return compact_rsa(it, level, capacity, universe);
+	}
+
+	iterator begin() const
+	{
+		return iterator(*this, 0);
+	}
+
+	iterator end() const
+	{
+		return iterator(*this, size_);
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	unsigned int level() const { return level_; }
+
+	unsigned int start() const { return start_; }
+
+	unsigned int term() const { return term_; }
+
+	void set_start(unsigned int start_)
+	{
+		auto size = term_ - this->start_;
+		this->start_ = start_;
+		term_ = start_ + size;
+	}
+
+	/** Empties the block, which is going to hold size entries from start() on */
+	void resize(size_t size_)
+	{
+		assert(size_ <= capacity_);
+		this->size_ = size_;
+		term_ = start_ + size_;
+		base_ = start_;
+		filled_ = 0;
+		last_high_ = 0;
+		std::fill(fields_, fields_ + units_, unit_type(0));
+	}
+
+	/** Sets the entry idx, which must be the next one and have a higher rank than the previous */
+	void set(size_t idx, const value_type &entry)
+	{
+		assert(idx == filled_ && idx < size_);
+		std::uint64_t pos = std::get<0>(entry), rank = std::get<1>(entry);
+		assert(pos >= base_ && pos - base_ < (std::uint64_t(1) << pos_bits_));
+		auto high = (rank >> low_bits_) + idx;
+		assert(idx == 0 || high > last_high_);
+		auto low = rank & ((std::uint64_t(1) << low_bits_) - 1);
+		auto width = low_bits_ + pos_bits_;
+		auto field = low | ((pos - base_) << low_bits_);
+		// Branchless: the field may end in the next unit, possibly the padding one
+		size_t bit = idx * width;
+		auto shift = bit & 63U;
+		fields_[bit >> 6] |= field << shift;
+		fields_[(bit >> 6) + 1] |= (field >> 1) >> (63 - shift);
+		high_[high >> 6] |= std::uint64_t(1) << (high & 63U);
+#ifndef NDEBUG
+		last_high_ = high;
+		filled_ = idx + 1;
+#endif
+	}
+};
+
+#endif
@@ -17,6 +17,8 @@
 #ifndef __COST_MODEL_
 #define __COST_MODEL_
 
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
@@ -117,6 +119,93 @@ struct class_info {
 	}
 };
 
+/**
+ * Finds the class of a value in a sorted vector of class bounds, i.e. the
+ * index of the first bound not below it, without a binary search:
+ * - values below direct_size are looked up in a table;
+ * - larger values go to the bucket [2^k, 2^(k+1)) of their highest bit,
+ *   which starts in a known class and, with classes growing as those of
+ *   the encoders do, contains at most max_splits bounds.
+ * Buckets holding more bounds, and bounds with too many classes for the
+ * tables, fall back to std::lower_bound.
+ */
+class class_finder {
+private:
+	static const size_t direct_size = 256U;
+	static const size_t max_splits = 2U;
+	static const size_t max_classes = 255U;
+
+	struct bucket {
+		/** Class of 2^k */
+		std::uint8_t first;
+		/** Too many bounds in the bucket: search them */
+		bool search;
+		/** Bounds in [2^k, 2^(k+1) - 1), padded with the maximum */
+		std::array<unsigned int, max_splits> splits;
+	};
+
+	bool use_tables;
+	std::array<std::uint8_t, direct_size> direct;
+	std::array<bucket, 32> buckets;
+
+	static unsigned int search(unsigned int x, const std::vector<unsigned int> &bounds)
+	{
+		auto ptr = std::lower_bound(bounds.begin(), bounds.end(), x);
+		return std::distance(bounds.begin(), ptr);
+	}
+
+public:
+	class_finder() : use_tables(false)
+	{
+
+	}
+
+	explicit class_finder(const std::vector<unsigned int> &bounds) : use_tables(bounds.size() <= max_classes)
+	{
+		if (!use_tables) {
+			return;
+		}
+		for (unsigned int x = 0; x < direct_size; x++) {
+			direct[x] = search(x, bounds);
+		}
+		for (unsigned int k = 0; k < buckets.size(); k++) {
+			auto &b = buckets[k];
+			unsigned int lo = 1U << k, hi = lo | (lo - 1);
+			b.first = search(lo, bounds);
+			b.search = false;
+			b.splits.fill(std::numeric_limits<unsigned int>::max());
+			size_t splits = 0;
+			for (auto i = b.first; i < bounds.size() && bounds[i] < hi; i++) {
+				if (splits == max_splits) {
+					b.search = true;
+					break;
+				}
+				b.splits[splits++] = bounds[i];
+			}
+		}
+	}
+
+	/** Class of x among bounds, which must be the ones given at construction */
+	unsigned int find(unsigned int x, const std::vector<unsigned int> &bounds) const noexcept
+	{
+		if (!use_tables) {
+			return search(x, bounds);
+		}
+		if (x < direct_size) {
+			return direct[x];
+		}
+		auto &b = buckets[31 - __builtin_clz(x)];
+		if (b.search) {
+			return search(x, bounds);
+		}
+		unsigned int to_ret = b.first;
+		for (auto split : b.splits) {
+			to_ret += x > split;
+		}
+		return to_ret;
+	}
+};
+
 class cost_matrix {
 private:
 	boost::numeric::ublas::matrix<double> m;
@@ -178,6 +267,34 @@ public:
 
 };
 
+/**
+ * The recent distances a copy may repeat at a lower cost: those of the last
+ * two copies with different distances (0 if none).
+ */
+struct rep_distances {
+	std::uint32_t last;
+	std::uint32_t previous;
+
+	rep_distances() : last(0U), previous(0U)
+	{
+
+	}
+
+	bool contains(std::uint32_t dst) const noexcept
+	{
+		return dst == last || dst == previous;
+	}
+
+	/** Updates the distances after a copy of distance dst */
+	void push(std::uint32_t dst) noexcept
+	{
+		if (dst != last) {
+			previous = last;
+			last = dst;
+		}
+	}
+};
+
 class cost_model {
 private:
 	/** Original dst */
@@ -193,15 +310,11 @@ private:
     std::vector<double> cost_map;
     // Fixed cost per character
 	double cost_per_char_;
-	// Vectors used to find out the ID
-	std::vector<unsigned int> search_dst;
-	std::vector<unsigned int> search_len;
-
-	unsigned int search(unsigned int x, const std::vector<unsigned int> &vect) const
-	{
-		auto ptr = std::lower_bound(vect.begin(), vect.end(), x);
-		return std::distance(vect.begin(), ptr);
-	}
+	/** Cost of a copy repeating a recent distance, by length class (empty: not supported) */
+	std::vector<double> rep_costs;
+	// Classes of distances and lengths, used to find out the ID
+	class_finder find_dst;
+	class_finder find_len;
 
 	std::vector<double> build_cost_map(cost_matrix m)
 	{
@@ -236,12 +349,10 @@ public:
 		std::vector<unsigned int> dsts, std::vector<unsigned int> lens, cost_matrix costs,
 		double lit_fixed_cost, double lit_var_cost, double cost_per_char = 0.0
 	) : dsts(dsts), lens(lens), lit_fixed_cost(lit_fixed_cost), lit_var_cost(lit_var_cost), 
-		map(lens.size()), cost_map(build_cost_map(costs)), cost_per_char_(cost_per_char)
+		map(lens.size()), cost_map(build_cost_map(costs)), cost_per_char_(cost_per_char),
+		find_dst(this->dsts), find_len(this->lens)
 	{
-		search_dst = dsts;
-		search_len = lens;
-		search_dst.insert(search_dst.begin(), 0);
-		search_len.insert(search_len.begin(), 0);
+
 	}
 
 	std::vector<unsigned int> get_dst() const { return dsts; }
@@ -267,7 +378,7 @@ public:
 	{
 		assert(dst <= dsts.back());
 		assert(len <= lens.back());
-		return std::make_tuple(search(dst, dsts), search(len, lens));
+		return std::make_tuple(find_dst.find(dst, dsts), find_len.find(len, lens));
 	}
 
 	id_t get_id(unsigned int dst, unsigned int len) const noexcept
@@ -293,6 +404,35 @@ public:
 		return (edge.kind() == REGULAR) ? get_cost(edge.cost_id) : lit_cost(edge.ell);
 	}
 
+	/** Sets the costs of the copies repeating a recent distance, one per length class */
+	void set_rep_costs(std::vector<double> costs)
+	{
+		assert(costs.empty() || costs.size() == lens.size());
+		rep_costs = costs;
+	}
+
+	/** Tells if copies repeating a recent distance (see rep_distances) have costs of their own */
+	bool has_rep() const noexcept
+	{
+		return !rep_costs.empty();
+	}
+
+	/** Cost of a copy of length len repeating a recent distance (see has_rep()) */
+	double rep_cost(unsigned int len) const noexcept
+	{
+		assert(has_rep());
+		return rep_costs[find_len.find(len, lens)];
+	}
+
+	/** Cost of an edge following a path whose last distances are reps */
+	double edge_cost(const edge_t &edge, const rep_distances &reps) const noexcept
+	{
+		if (edge.kind() == REGULAR && reps.contains(edge.d) && has_rep()) {
+			return rep_cost(edge.ell);
+		}
+		return edge_cost(edge);
+	}
+
 	cost_matrix get_cm() const
 	{
 		cost_matrix to_ret(dsts.size(), lens.size());
@@ -326,7 +466,7 @@ public:
 		return std::string(hex_hash, hex_hash + hex_hash_size);
 	}
 
-	edge_t get_edge(unsigned int dst, unsigned int len)
+	edge_t get_edge(unsigned int dst, unsigned int len) const
 	{
 		if (dst == 0) {
 			return edge_t(len);
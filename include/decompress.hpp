@@ -20,15 +20,29 @@
 #include <string>
 #include <iostream>
 #include <chrono>
+#include <algorithm>
+#include <vector>
 
 #include <utilities.hpp>
 #include <cmd_parse.hpp>
 #include <encoders.hpp>
 #include <factory.hpp>
 #include <io.hpp>
+#include <format.hpp>
+#include <checksum.hpp>
 
 #include <sys/mman.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define DECODE_BMI2
+#endif
+
+/**
+ * True if the CPU has BMI1 and BMI2, whose tzcnt, shrx and bzhi speed up
+ * the bit-level decoders (detected once)
+ */
+bool has_bmi2();
+
 struct fast_copy {
 	template <typename T>
 	void operator()(T *dest, T *src, size_t len)
@@ -41,38 +55,46 @@ class base_decompress {
 public:
 	virtual void run(byte *input, byte *output, size_t size, std::uint64_t *dec_time) = 0;
 
+	/** Decodes the first prefix bytes of a text of size bytes, writing none past them */
+	virtual void run_prefix(byte *input, byte *output, size_t size, size_t prefix) = 0;
+
 	virtual ~base_decompress()
 	{
 	}
 };
 
-template <typename enc_, typename copier_ = fast_copy>
+/** Copies decoded ahead by the prefetching decoders (a power of two) */
+const unsigned int prefetch_lookahead = 8U;
+
+/**
+ * Decompressor of the parsings of an encoder. With a lookahead, the headers
+ * of the next copies are decoded into a ring of that many entries and the
+ * sources of the copies are prefetched, so that the cache misses of far
+ * copies overlap. Literal runs empty the ring, as copies may write past
+ * their end.
+ */
+template <typename enc_, typename copier_ = fast_copy, unsigned int lookahead_ = 0U>
 class decompress : public base_decompress {
-public:
-	void run(byte *input, byte *output, size_t size, std::uint64_t *dec_time = nullptr)
-	{
-		typedef typename enc_::decoder dec_t;
-		dec_t decoder(input, size);
-		copier_ copy;
+private:
+	typedef typename enc_::decoder dec_t;
 
-//		const byte *start = output;
-		byte *end = output + size;
+	static_assert((lookahead_ & (lookahead_ - 1)) == 0, "The lookahead must be a power of two");
 
-		auto time_1 = std::chrono::high_resolution_clock::now();
+	static void decode(dec_t &decoder, byte *output, byte *end)
+	{
+		if (lookahead_ > 0U) {
+			decode_ahead(decoder, output, end);
+			return;
+		}
+		copier_ copy;
 		uint32_t dist, len, nextliteral;
 		decoder.decode(output, len, nextliteral);
 		output += len;
 
-//		std::cout << size << std::endl;
-
 		while (output < end) {
 			if (nextliteral > 0) {
 				decoder.decode(dist, len);
-
-//				std::cout << dist << "\t" << len << std::endl;
-
 				assert(output + len <= end);
-//				assert(output - dist >= start);
 				copy(output, output - dist, len);
 				output += len;
 				nextliteral--;
@@ -83,31 +105,147 @@ public:
 				output += len;
 			}
 		}
+	}
+
+	static void decode_ahead(dec_t &decoder, byte *output, byte *end)
+	{
+		const unsigned int ring_size = lookahead_ > 0U ? lookahead_ : 1U;
+		const unsigned int mask = ring_size - 1;
+		copier_ copy;
+		std::uint32_t dists[ring_size], lens[ring_size];
+		unsigned int head = 0, tail = 0;
+		uint32_t len, nextliteral;
+		decoder.decode(output, len, nextliteral);
+		output += len;
+		// Where the copies decoded so far end
+		byte *ahead = output;
+
+		while (output < end) {
+			// The last literal run may count one copy more than there are
+			while (tail - head < ring_size && nextliteral > 0 && ahead < end) {
+				auto &dist = dists[tail & mask];
+				decoder.decode(dist, lens[tail & mask]);
+				__builtin_prefetch(ahead - dist);
+				ahead += lens[tail & mask];
+				++tail;
+				--nextliteral;
+			}
+			if (head == tail) {
+				decoder.decode(output, len, nextliteral);
+				assert(output + len <= end);
+				assert(len > 0);
+				output += len;
+				ahead = output;
+				continue;
+			}
+			auto dist = dists[head & mask];
+			len = lens[head & mask];
+			++head;
+			assert(output + len <= end);
+			copy(output, output - dist, len);
+			output += len;
+		}
+	}
+
+	/**
+	 * decode() up to end, which may fall within a phrase of a text ending at
+	 * text_end. Near end, copies are clipped and byte by byte, literal runs
+	 * decoded aside.
+	 */
+	static void decode_prefix(dec_t &decoder, byte *output, byte *end, byte *text_end)
+	{
+		copier_ copy;
+		// 0 if literal runs have no limit
+		const size_t literal_len = enc_::encoder::get_literal_len();
+		std::vector<byte> scratch;
+		std::uint32_t dist, len, nextliteral = 0;
+		while (output < end) {
+			size_t room = end - output;
+			if (nextliteral > 0) {
+				decoder.decode(dist, len);
+				if (len + in_place_slack <= room) {
+					copy(output, output - dist, len);
+				} else {
+					// Byte by byte, as the source may overlap the copy
+					byte *src = output - dist;
+					std::uint32_t clipped = std::min<size_t>(len, room);
+					for (std::uint32_t i = 0; i < clipped; i++) {
+						output[i] = src[i];
+					}
+				}
+				nextliteral--;
+			} else {
+				size_t longest = text_end - output;
+				if (literal_len > 0) {
+					longest = std::min(longest, literal_len);
+				}
+				if (longest + in_place_slack <= room) {
+					decoder.decode(output, len, nextliteral);
+				} else {
+					scratch.resize(longest + in_place_slack);
+					decoder.decode(scratch.data(), len, nextliteral);
+					std::copy(scratch.data(), scratch.data() + std::min<size_t>(len, room), output);
+				}
+			}
+			assert(len > 0);
+			output += std::min<size_t>(len, room);
+		}
+	}
+
+#ifdef DECODE_BMI2
+	/** decode(), with the whole loop inlined and compiled for BMI1/BMI2 */
+	__attribute__((target("bmi,bmi2"), flatten))
+	static void decode_bmi2(dec_t &decoder, byte *output, byte *end)
+	{
+		decode(decoder, output, end);
+	}
+#endif
+
+public:
+	void run(byte *input, byte *output, size_t size, std::uint64_t *dec_time = nullptr)
+	{
+		dec_t decoder(input, size);
+		byte *end = output + size;
+
+		auto time_1 = std::chrono::high_resolution_clock::now();
+#ifdef DECODE_BMI2
+		if (has_bmi2()) {
+			decode_bmi2(decoder, output, end);
+		} else
+#endif
+		decode(decoder, output, end);
 		auto time_2 = std::chrono::high_resolution_clock::now();
 		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time_2 - time_1).count();
 		if (dec_time != nullptr) {
 			*dec_time = elapsed;
 		}
 	}
+
+	void run_prefix(byte *input, byte *output, size_t size, size_t prefix)
+	{
+		dec_t decoder(input, size);
+		decode_prefix(decoder, output, output + std::min(prefix, size), output + size);
+	}
 };
 
-template <typename copier_>
+template <typename copier_, unsigned int lookahead_ = 0U>
 class dec_fact {
 public:
 	template <typename enc_>
 	std::unique_ptr<base_decompress> get_instance() const
 	{
-		return make_unique<decompress<enc_, copier_>>();
+		return make_unique<decompress<enc_, copier_, lookahead_>>();
 	}
 };
 
 std::uint32_t extract_size(byte *comp, byte **new_ptr = nullptr);
 
-template <typename copy_ = fast_copy>
+/** Decompresses a parsing, with a prefetching decoder if lookahead_ > 0 (see decompress) */
+template <typename copy_ = fast_copy, unsigned int lookahead_ = 0U>
 std::uint64_t decompress_raw(const char *encoder, byte *parsing, byte *output, size_t uncompressed_size)
 {
-	dec_fact<copy_> fact;
-	auto decompressor = encoders_().instantiate<base_decompress, dec_fact<copy_>>(encoder, fact);
+	dec_fact<copy_, lookahead_> fact;
+	auto decompressor = encoders_().instantiate<base_decompress, dec_fact<copy_, lookahead_>>(encoder, fact);
 
 	std::uint64_t elapsed;
 	decompressor->run(parsing, output, uncompressed_size, &elapsed);
@@ -121,9 +259,21 @@ typedef struct _decompress_output {
 	size_t uncompressed_size;
 	// In nanoseconds
 	std::uint64_t dec_time;
+	// Only read by decompress_in_place
+	block_checksums checksums;
 } dec_output;
 
-dec_output decompress_full(byte *data);
+/** Decompresses a full file, with the prefetching decoder if prefetch */
+dec_output decompress_full(byte *data, bool prefetch = false);
+
+/**
+ * Decompresses a full file of file_size bytes read from in, in place: the
+ * parsing is read at the end of a buffer as large as the text plus the
+ * in-place margin of the header (see in_place_margin), and the text decoded
+ * from its start, without a buffer for the whole file. The checksums, if
+ * any, are read as well.
+ */
+dec_output decompress_in_place(std::istream &in, size_t file_size, bool prefetch = false);
 
 std::uint64_t decompress_file(const char *tool_name, int argc, char **argv, std::ostream &out = std::cout);
 
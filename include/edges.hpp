@@ -58,6 +58,14 @@ class ec_factory;
 class bi_factory;
 
 /********** EDGE COSTS: WRAPPERS    ***********/
+/**
+ * Sums of multiples of 2^-cost_grid_bits below exact_cost_bound are exact,
+ * so comparisons between paths of such costs do not depend on the order of
+ * the additions (see on_grid() in parallel_parser.hpp).
+ */
+const int cost_grid_bits = 16;
+const double exact_cost_bound = double(1ULL << (std::numeric_limits<double>::digits - cost_grid_bits - 1));
+
 class edge_cost {
 private:
 	double cost;
@@ -74,6 +82,10 @@ public:
 		: cost(cm.edge_cost(edge))
 	{}
 
+	edge_cost(const edge_t &edge, const rep_distances &reps, const cost_model &cm)
+		: cost(cm.edge_cost(edge, reps))
+	{}
+
 	bool operator<(const edge_cost &other) const { return cost < other.cost; }
 
 	bool operator==(const edge_cost &other) const { return cost == other.cost; }
@@ -114,6 +126,12 @@ public:
 		cost = 0.0;
 	}
 
+	/** Tells if sums of up to times grid values not above this one are exact */
+	bool exact(size_t times) const
+	{
+		return cost * times < exact_cost_bound;
+	}
+
 //	edge_cost &add_cost(double amount)
 //	{
 //		cost += amount;
@@ -143,6 +161,12 @@ public:
 
 	}
 
+	bi_edge_cost(const edge_t &edge, const rep_distances &reps, const cost_model &cost_cm, const cost_model &weight_cm)
+		: bi_edge_cost(cost_cm.edge_cost(edge, reps), weight_cm.edge_cost(edge, reps))
+	{
+
+	}
+
 	bool operator<(const bi_edge_cost &other) const
 	{
 		if (cost != other.cost) {
@@ -187,6 +211,11 @@ public:
 
 	void zero() { cost = weight = 0.0; }
 
+	bool exact(size_t times) const
+	{
+		return cost * times < exact_cost_bound && weight * times < exact_cost_bound;
+	}
+
 	double get_value() const { return cost; }
 };
 
@@ -202,6 +231,23 @@ public:
     {
         return edge_cost(edge, cm);
     }
+
+	/** Cost of an edge following copies with the given recent distances */
+	edge_cost get(const edge_t &edge, const rep_distances &reps) const
+	{
+		return edge_cost(edge, reps, cm);
+	}
+
+	/** Tells if copies repeating a recent distance are cheaper */
+	bool has_rep() const
+	{
+		return cm.has_rep();
+	}
+
+	const cost_model &model() const
+	{
+		return cm;
+	}
 };
 
 class bi_factory {
@@ -217,5 +263,21 @@ public:
     {
 		return bi_edge_cost(edge, cost_cm, weight_cm);
     }
+
+	bi_edge_cost get(const edge_t &edge, const rep_distances &reps) const
+	{
+		return bi_edge_cost(edge, reps, cost_cm, weight_cm);
+	}
+
+	bool has_rep() const
+	{
+		return cost_cm.has_rep() || weight_cm.has_rep();
+	}
+
+	/** The model of the cost (whose classes the weight model shares) */
+	const cost_model &model() const
+	{
+		return cost_cm;
+	}
 };
 #endif // EDGES_HPP
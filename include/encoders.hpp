@@ -23,12 +23,16 @@
 #include <stdint.h>
 #include <stdexcept>
 #include <cstddef>
+#include <cstring>
 #include <array>
+#include <type_traits>
+#include <vector>
 
 #include <common.hpp>
 #include <cost_model.hpp>
 #include <copy_routines.hpp>
 #include <factory.hpp>
+#include <huffman.hpp>
 #include <unaligned_io.hpp>
 
 struct enc_cost_info {
@@ -426,6 +430,487 @@ struct hybrid_coder_1 {
 	}
 };
 
+/*********************** REP ENCODER/DECODER FUNCTIONS ***************************/
+/**
+ * Hybrid with repeated distances: a copy repeating one of the recent
+ * distances (see rep_distances in cost_model.hpp) stores its index, 0 or 1,
+ * in place of its distance, which takes a byte. Other distances are stored
+ * plus one rather than minus one, so the classes of hybrid lose their last
+ * two distances; lengths are hybrid's.
+ */
+namespace rep {
+
+inline byte *dst_encode(std::uint32_t to_encode, const rep_distances &reps, byte *write)
+{
+	std::uint32_t stored = to_encode == reps.last ? 0U : to_encode == reps.previous ? 1U : to_encode + 1U;
+	return lzopt::hybrid::dst_encode(stored + 1U, write);
+}
+
+inline byte *dst_decode(byte * const read, std::uint32_t *value, const rep_distances &reps)
+{
+	std::uint32_t stored;
+	auto next = lzopt::hybrid::dst_decode(read, &stored);
+	--stored;
+	*value = stored == 0U ? reps.last : stored == 1U ? reps.previous : stored - 1U;
+	return next;
+}
+
+/**
+ * The encoder class.
+ * @param lit_t
+ *		The type of the literal run encoder
+ */
+template <typename lit_t>
+class encoder : public base_encoder {
+private:
+	// The data where we put the encoding -- we don't own it.
+	byte *data;
+	// The pointer to the ``original'' pointer
+	byte *start_data;
+	// The literal writer
+	lit_t lit_write;
+	rep_distances reps;
+public:
+
+	typedef lit_t literal_encoder_t;
+
+	encoder(byte* data_, size_t data_size) : data(data_), start_data(data_)
+	{
+		set_len(data_size);
+	}
+
+	inline void encode(std::uint32_t dst, std::uint32_t len)
+	{
+		assert(data - start_data < get_len());
+		data = lzopt::rep::dst_encode(dst, reps, data);
+		reps.push(dst);
+		data = lzopt::hybrid::len_encode(len, data);
+	}
+
+	inline void encode(byte *literal_run, unsigned int ell, std::uint32_t next)
+	{
+		data = lit_write.encode(ell, data, literal_run, next);
+	}
+
+	/** Bytes written so far */
+	size_t written() const
+	{
+		return data - start_data;
+	}
+
+	/**
+	 * @brief Gets the amount of data (in BYTES) needed to store a parsing of length parsing_length (in BITS)
+	 * @param parsing_length
+	 *		The parsing length, in bits
+	 * @return
+	 *		The amount of of data (in BYTES) needed to store the parsing.
+	 */
+	static size_t data_len(size_t parsing_length)
+	{
+		return std::ceil(parsing_length / 8) + 8;
+	}
+
+	static enc_cost_info get_info()
+	{
+		std::vector<unsigned int> dst =  {(1 << 6) - 2, (1 << 14) - 2, (1 << 22) - 2, (1 << 30) - 2};
+		std::vector<unsigned int> dstcst = {8, 16, 24, 32};
+		std::vector<unsigned int> len = {(1 << 7), (1 << 15)};
+		std::vector<unsigned int> lencst = {8, 16};
+
+		return {dst, dstcst, len, lencst};
+	}
+
+	static cost_model get_cm()
+	{
+		enc_cost_info info = get_info();
+
+		class_info dst_class(info.dst.begin(), info.dst.end(), info.dstcst.begin(), info.dstcst.end());
+		class_info len_class(info.len.begin(), info.len.end(), info.lencst.begin(), info.lencst.end());
+		lit_t writer;
+		cost_model cm(dst_class, len_class, writer.fixed_cost(), writer.var_cost());
+		// Repeated copies take a byte in place of their distance
+		std::vector<double> rep_costs;
+		for (auto cost : info.lencst) {
+			rep_costs.push_back(cost + 8U);
+		}
+		cm.set_rep_costs(rep_costs);
+		return cm;
+	}
+
+	static size_t get_literal_len()
+	{
+		lit_t writer;
+		return writer.max_length();
+	}
+
+	virtual ~encoder()
+	{
+
+	}
+};
+
+template <typename lit_type>
+class decoder : public base_encoder {
+private:
+	// The data being decoded -- we don't own it.
+	byte *data;
+	lit_type lit_read;
+	rep_distances reps;
+
+public:
+	decoder(byte *array, size_t text_length) : data(array)
+	{
+		set_len(text_length);
+	}
+
+	inline void decode(std::uint32_t &dst, std::uint32_t &len)
+	{
+		data = lzopt::rep::dst_decode(data, &dst, reps);
+		reps.push(dst);
+		data = lzopt::hybrid::len_decode(data, &len);
+	}
+
+	inline void decode(byte *str, std::uint32_t &len, std::uint32_t &next)
+	{
+		data = lit_read.decode(len, data, str, next);
+	}
+
+	// Returns the amount of extra memory to be reserved for allocating the
+	// file
+	static size_t extra_read()
+	{
+		return 8U;
+	}
+};
+
+} // Namespace lzopt::rep
+
+struct rep_coder_8 {
+	typedef lzopt::rep::encoder<lit_8> encoder;
+	typedef lzopt::rep::decoder<lit_8> decoder;
+	static std::string name()
+	{
+		return "hybrid-rep-8";
+	}
+};
+
+struct rep_coder_16 {
+	typedef lzopt::rep::encoder<lit_16> encoder;
+	typedef lzopt::rep::decoder<lit_16> decoder;
+	static std::string name()
+	{
+		return "hybrid-rep-16";
+	}
+};
+
+/*********************** SPLIT ENCODER/DECODER FUNCTIONS *************************/
+/**
+ * Separated-stream layout: every kind of field goes to a stream of its own,
+ * so that the decoder reads each of them sequentially:
+ * - runs: length - 1 (run_t) and nextliteral (32 bits) of each literal run;
+ * - literals: the bytes of the literal runs;
+ * - lengths and distances: the byte-aligned codes of hybrid.
+ * A parsing starts with the sizes in bytes of the first three streams
+ * (32 bits each), and the distances take the rest.
+ *
+ * Fields cost exactly as in hybrid with literal_write<run_t>, hence the cost
+ * models are the same. The literals stream may also be entropy-coded (see
+ * huffman_literals): then the static cost model stays an upper bound, used
+ * to size the output, while get_cm(text, len) estimates the literal cost
+ * from the text, for the parser.
+ */
+namespace split {
+
+enum stream_id {RUNS, LITERALS, LENGTHS, DISTANCES};
+
+const unsigned int stream_count = 4U;
+
+/** Bytes taken by the stream sizes */
+const size_t header_size = (stream_count - 1) * sizeof(std::uint32_t);
+
+/** Literals stored verbatim */
+struct raw_literals {
+	static const size_t padding = 8U;
+
+	/** Bytes to be reserved on top of the literals */
+	static size_t overhead(size_t)
+	{
+		return 0U;
+	}
+
+	static void encode(std::vector<byte> &)
+	{
+
+	}
+
+	/** Cost (in bits) of a literal of text[0, len) */
+	static double literal_cost(const byte *, size_t)
+	{
+		return 8.0;
+	}
+
+	class reader {
+	private:
+		byte *data;
+	public:
+		reader(byte *data) : data(data)
+		{
+
+		}
+
+		void read(byte *dest, size_t len)
+		{
+			u_copy_fast(dest, data, len);
+			data += len;
+		}
+	};
+};
+
+/** Literals Huffman-coded in blocks (see huffman.hpp) */
+struct huffman_literals {
+	static const size_t padding = huffman::padding;
+
+	static size_t overhead(size_t literals)
+	{
+		return huffman::max_encoded_len(literals) - literals + padding;
+	}
+
+	static void encode(std::vector<byte> &literals)
+	{
+		std::vector<byte> coded;
+		huffman::encode(literals.data(), literals.size(), coded);
+		std::swap(literals, coded);
+	}
+
+	static double literal_cost(const byte *text, size_t len)
+	{
+		return huffman::symbol_cost(text, len);
+	}
+
+	typedef huffman::block_reader reader;
+};
+
+template <typename run_t, typename literal_coder = raw_literals>
+class decoder;
+
+/**
+ * The encoder class. Streams are buffered, and laid out in the output on
+ * flush() or on destruction.
+ */
+template <typename run_t, typename literal_coder = raw_literals>
+class encoder : public base_encoder {
+private:
+	typedef hybrid::encoder<literal_write<run_t>> hybrid_t;
+
+	// The data where we put the encoding -- we don't own it.
+	byte *data;
+	std::array<std::vector<byte>, stream_count> streams;
+	bool flushed;
+	size_t written;
+
+	template <typename T>
+	void append(stream_id id, T value)
+	{
+		auto &s = streams[id];
+		auto size = s.size();
+		s.resize(size + sizeof(value));
+		std::memcpy(s.data() + size, &value, sizeof(value));
+	}
+
+public:
+	encoder(byte *data_, size_t data_size) : data(data_), flushed(false), written(0)
+	{
+		set_len(data_size);
+	}
+
+	/* Moved-from encoders do not flush */
+	encoder(encoder &&other) noexcept
+		: data(other.data), streams(std::move(other.streams)), flushed(other.flushed), written(other.written)
+	{
+		set_len(other.get_len());
+		other.flushed = true;
+	}
+
+	encoder(const encoder &) = delete;
+
+	encoder &operator=(const encoder &) = delete;
+
+	inline void encode(std::uint32_t dst, std::uint32_t len)
+	{
+		byte code[4];
+		auto &d = streams[DISTANCES];
+		d.insert(d.end(), code, lzopt::hybrid::dst_encode(dst, code));
+		auto &l = streams[LENGTHS];
+		l.insert(l.end(), code, lzopt::hybrid::len_encode(len, code));
+	}
+
+	inline void encode(byte *literal_run, unsigned int ell, std::uint32_t next)
+	{
+		assert(ell > 0 && ell <= get_literal_len());
+		append(RUNS, static_cast<run_t>(ell - 1));
+		append(RUNS, next);
+		auto &l = streams[LITERALS];
+		l.insert(l.end(), literal_run, literal_run + ell);
+	}
+
+	/**
+	 * Writes the header and the streams; later phrases are not allowed.
+	 * Returns the bytes written, decoder overread included.
+	 */
+	size_t flush()
+	{
+		if (flushed) {
+			return written;
+		}
+		flushed = true;
+		literal_coder::encode(streams[LITERALS]);
+		byte *write = data;
+		for (unsigned int i = 0; i < stream_count - 1; i++) {
+			std::uint32_t size = streams[i].size();
+			std::memcpy(write, &size, sizeof(size));
+			write += sizeof(size);
+		}
+		for (auto &s : streams) {
+			write = std::copy(s.begin(), s.end(), write);
+		}
+		written = std::min<size_t>(write - data + decoder<run_t, literal_coder>::extra_read(), get_len());
+		assert(static_cast<size_t>(write - data) <= get_len());
+		return written;
+	}
+
+	/**
+	 * @brief Gets the amount of data (in BYTES) needed to store a parsing of length parsing_length (in BITS)
+	 * @param parsing_length
+	 *		The parsing length, in bits
+	 * @return
+	 *		The amount of of data (in BYTES) needed to store the parsing.
+	 */
+	static size_t data_len(size_t parsing_length)
+	{
+		return hybrid_t::data_len(parsing_length) + header_size + literal_coder::overhead(parsing_length / 8);
+	}
+
+	static enc_cost_info get_info()
+	{
+		return hybrid_t::get_info();
+	}
+
+	static cost_model get_cm()
+	{
+		return hybrid_t::get_cm();
+	}
+
+	/** Cost model with the literal cost estimated on text[0, len) */
+	static cost_model get_cm(const byte *text, size_t len)
+	{
+		enc_cost_info info = get_info();
+		class_info dst_class(info.dst.begin(), info.dst.end(), info.dstcst.begin(), info.dstcst.end());
+		class_info len_class(info.len.begin(), info.len.end(), info.lencst.begin(), info.lencst.end());
+		literal_write<run_t> writer;
+		return cost_model(dst_class, len_class, writer.fixed_cost(), literal_coder::literal_cost(text, len));
+	}
+
+	static size_t get_literal_len()
+	{
+		return hybrid_t::get_literal_len();
+	}
+
+	virtual ~encoder()
+	{
+		flush();
+	}
+};
+
+template <typename run_t, typename literal_coder>
+class decoder : public base_encoder {
+private:
+	// Reading heads of the streams -- we don't own them.
+	byte *runs;
+	typename literal_coder::reader literals;
+	byte *lengths;
+	byte *distances;
+
+	static byte *stream(byte *array, stream_id id)
+	{
+		std::array<std::uint32_t, stream_count - 1> sizes;
+		std::memcpy(sizes.data(), array, header_size);
+		auto start = array + header_size;
+		for (unsigned int i = 0; i < id; i++) {
+			start += sizes[i];
+		}
+		return start;
+	}
+
+public:
+	decoder(byte *array, size_t text_length)
+		: runs(stream(array, RUNS)), literals(stream(array, LITERALS)),
+		  lengths(stream(array, LENGTHS)), distances(stream(array, DISTANCES))
+	{
+		set_len(text_length);
+	}
+
+	inline void decode(std::uint32_t &dst, std::uint32_t &len)
+	{
+		distances = lzopt::hybrid::dst_decode(distances, &dst);
+		lengths = lzopt::hybrid::len_decode(lengths, &len);
+	}
+
+	inline void decode(byte *str, std::uint32_t &len, std::uint32_t &next)
+	{
+		run_t stored;
+		std::memcpy(&stored, runs, sizeof(stored));
+		std::memcpy(&next, runs + sizeof(stored), sizeof(next));
+		runs += sizeof(stored) + sizeof(next);
+		len = stored + 1U;
+		literals.read(str, len);
+	}
+
+	// Returns the amount of extra memory to be reserved for allocating the
+	// file
+	static size_t extra_read()
+	{
+		return std::max<size_t>(8U, literal_coder::padding);
+	}
+};
+
+} // Namespace lzopt::split
+
+struct split_coder_8 {
+	typedef lzopt::split::encoder<std::uint8_t> encoder;
+	typedef lzopt::split::decoder<std::uint8_t> decoder;
+	static std::string name()
+	{
+		return "split-8";
+	}
+};
+
+struct split_coder_16 {
+	typedef lzopt::split::encoder<std::uint16_t> encoder;
+	typedef lzopt::split::decoder<std::uint16_t> decoder;
+	static std::string name()
+	{
+		return "split-16";
+	}
+};
+
+struct split_huff_coder_8 {
+	typedef lzopt::split::encoder<std::uint8_t, lzopt::split::huffman_literals> encoder;
+	typedef lzopt::split::decoder<std::uint8_t, lzopt::split::huffman_literals> decoder;
+	static std::string name()
+	{
+		return "split-huff-8";
+	}
+};
+
+struct split_huff_coder_16 {
+	typedef lzopt::split::encoder<std::uint16_t, lzopt::split::huffman_literals> encoder;
+	typedef lzopt::split::decoder<std::uint16_t, lzopt::split::huffman_literals> decoder;
+	static std::string name()
+	{
+		return "split-huff-16";
+	}
+};
+
 } // Namespace lzopt
 
 /************************* SODA09 DESCRIPTION *********************************/
@@ -502,6 +987,18 @@ std::uint32_t decode(unaligned_io::reader &reader)
 	// Second: skip those 1's, read the proper number of bits and append to the remainder
 }
 
+template <typename encoding>
+std::uint32_t decode(unaligned_io::bit_reader &reader)
+{
+	// The whole codeword is in the lookahead window
+	reader.refill();
+	std::uint64_t d_word = reader.lookahead();
+	unsigned int cost_class;
+	unary_suffix_length(d_word, cost_class);
+	reader.consume(1 + cost_class + encoding::binary_width[cost_class]);
+	return 1 + (((d_word >> (cost_class + 1)) & encoding::decode_mask[cost_class]) + encoding::cost_classes[cost_class]);
+}
+
 template <typename enc_inf, typename lit_write>
 class encoder : public lzopt::base_encoder {
 private:
@@ -594,7 +1091,7 @@ public:
 template <typename enc_inf, typename lit_read>
 class decoder : public lzopt::base_encoder {
 private:
-	unaligned_io::reader reader;
+	unaligned_io::bit_reader reader;
 	lit_read lit_reader;
 	typedef typename enc_inf::cost_classes::dst dst_ci;
 	typedef typename enc_inf::cost_classes::len len_ci;
@@ -620,7 +1117,7 @@ public:
 	// file
 	static size_t extra_read()
 	{
-		return 8U;
+		return unaligned_io::bit_reader::padding;
 	}
 };
 
@@ -719,6 +1216,47 @@ struct nibble4_coder_16U {
 	}
 };
 
+/** Bytes of the output (of capacity bytes) taken by an encoder, once done */
+template <typename enc_t>
+size_t written_len(enc_t &, size_t capacity)
+{
+	return capacity;
+}
+
+template <typename run_t, typename literal_coder>
+size_t written_len(lzopt::split::encoder<run_t, literal_coder> &enc, size_t)
+{
+	return enc.flush();
+}
+
+/**
+ * True for the encoders writing a single stream, read front to back by the
+ * decoder as the text is decoded
+ */
+template <typename enc_t>
+struct single_stream : std::true_type {
+};
+
+template <typename run_t, typename literal_coder>
+struct single_stream<lzopt::split::encoder<run_t, literal_coder>> : std::false_type {
+};
+
+/**
+ * Cost model of an encoder tuned on text[0, len), for the encoders that have
+ * one, the static cost model otherwise.
+ */
+template <typename enc_t>
+auto text_cm(const byte *text, size_t len, int) -> decltype(enc_t::get_cm(text, len))
+{
+	return enc_t::get_cm(text, len);
+}
+
+template <typename enc_t>
+cost_model text_cm(const byte *, size_t, long)
+{
+	return enc_t::get_cm();
+}
+
 /**
  * Defines a container of encoders.
  * The list of included encoders is encoded in the template parameters.
@@ -762,6 +1300,17 @@ struct encoders<T, U...>
 		}
 	}
 
+	// Get the cost model of an encoder for a given text (to parse it, not
+	// to size its compressed representation)
+	cost_model get_cm(std::string name, const byte *text, size_t len)
+	{
+		if (name == T::name()) {
+			return text_cm<typename T::encoder>(text, len, 0);
+		} else {
+			return encoders<U...>().get_cm(name, text, len);
+		}
+	}
+
 	// Get the cost model of an encoder
 	enc_cost_info get_info(std::string name)
 	{
@@ -823,6 +1372,11 @@ struct encoders<>
 		throw std::logic_error(error(name));
 	}
 
+	cost_model get_cm(std::string name, const byte *, size_t)
+	{
+		throw std::logic_error(error(name));
+	}
+
 	enc_cost_info get_info(std::string name)
 	{
 		throw std::logic_error(error(name));
@@ -839,6 +1393,8 @@ struct encoders<>
 // Defines a container with the list of all known encoders.
 typedef encoders<
 	lzopt::hybrid_coder_1, lzopt::hybrid_coder_8, lzopt::hybrid_coder_16,
+	lzopt::rep_coder_8, lzopt::rep_coder_16,
+	lzopt::split_coder_8, lzopt::split_coder_16, lzopt::split_huff_coder_8, lzopt::split_huff_coder_16,
 	soda09_coder_1, soda09_coder_8, soda09_coder_16, soda09_coder_8U, soda09_coder_16U,
 	nibble4_coder_1, nibble4_coder_8, nibble4_coder_16, nibble4_coder_8U, nibble4_coder_16U
 > encoders_;
@@ -25,6 +25,7 @@
 
 #include <scan.hpp>
 #include <online_rsa.hpp>
+#include <compact_rsa.hpp>
 #include <match_length.hpp>
 #include <utilities.hpp>
 #include <base_fsg.hpp>
@@ -102,7 +103,7 @@ public:
 template <typename T>
 class tuple_comp {
 public:
-	bool operator()(std::tuple<T, T> &e1, std::tuple<T, T> &e2)
+	bool operator()(const std::tuple<T, T> &e1, const std::tuple<T, T> &e2) const
 	{
 		return std::get<1>(e1) < std::get<1>(e2);
 	}
@@ -189,34 +190,49 @@ Output merge(
 	}
 }
 
+/**
+ * Blocks of the RSAs of the generators. Plain blocks are the fastest;
+ * bit-packed ones take a fraction of the memory, since they are only scanned
+ * forward by the merge, but decoding them slows the generation down by about
+ * a fifth (define COMPACT_RSA, or the CMake option of the same name).
+ */
+#ifdef COMPACT_RSA
+template <typename T>
+using rsa_block = compact_rsa<T>;
+#else
 template <typename T>
-class generic_rsa_getter {
+using rsa_block = rsa<std::tuple<T,T>>;
+#endif
+
+/** RSA getter of a generator, whose blocks are of type block_t (see rsa_queue) */
+template <typename T, typename block_t>
+class basic_rsa_getter {
 	size_t text_len;
 	std::vector<unsigned int> dst;
 	std::vector<unsigned int> cst;
 	// Sorted blocks getter
-	rsa_getter<T> b_getter;
-	rsa_getter<T> w_getter;
+	rsa_getter<T, block_t> b_getter;
+	rsa_getter<T, block_t> w_getter;
 	// RSA pre-allocated storage
 	std::vector<T> rsa_storage;
 
-	rsa<std::tuple<T, T>> empty_rsa()
+	block_t empty_rsa()
 	{
-		return rsa<std::tuple<T,T>>();
+		return block_t();
 	}
 
 public:
 
 	template <typename stats_get_t_>
-	generic_rsa_getter(
+	basic_rsa_getter(
 			stats_get_t_ stats,
 			std::shared_ptr<std::vector<T>> sa,
 			size_t text_length
 	)
 		:	text_len(text_length),
 			dst(stats.get_dst()), cst(stats.get_cost_class()),
-			b_getter(rsa_getter<T>::get_b_getter(dst, sa)),
-			w_getter(rsa_getter<T>::get_w_getter(dst, sa)),
+			b_getter(rsa_getter<T, block_t>::get_b_getter(dst, sa)),
+			w_getter(rsa_getter<T, block_t>::get_w_getter(dst, sa)),
 			rsa_storage(text_length)
 	{
 
@@ -286,13 +302,16 @@ public:
 		return MULTIPLE;
 	}
 
-	generic_rsa_getter(const generic_rsa_getter &) = delete;
-	generic_rsa_getter(generic_rsa_getter &&) = default;
+	basic_rsa_getter(const basic_rsa_getter &) = delete;
+	basic_rsa_getter(basic_rsa_getter &&) = default;
 
-	generic_rsa_getter &operator=(const generic_rsa_getter &) = delete;
-	generic_rsa_getter &operator=(generic_rsa_getter &&) = default;
+	basic_rsa_getter &operator=(const basic_rsa_getter &) = delete;
+	basic_rsa_getter &operator=(basic_rsa_getter &&) = default;
 };
 
+template <typename T>
+using generic_rsa_getter = basic_rsa_getter<T, rsa_block<T>>;
+
 template <typename T>
 class same_rsa_getter {
 private:
@@ -22,7 +22,26 @@
 
 #include <common.hpp>
 
+/**
+ * Header of a compressed file: format_magic and format_version, the encoder
+ * name (null-terminated), the uncompressed length, the in-place margin, the
+ * bytes to be reserved past the end of the text to decompress it in place
+ * (see decompress_in_place), and the checksum block size. A margin of 0 is
+ * unknown. With a block size, the CRC32C of every block of the text (see
+ * checksum.hpp) follows the parsing, at the end of the file.
+ *
+ * Files without the magic are of the first format: the encoder name and
+ * the uncompressed length, with an unknown margin and no checksums.
+ * Unpacking a file of another version throws a std::runtime_error.
+ */
 typedef std::uint32_t uncomp_size_t;
+
+/** Starts every compressed file: no encoder name starts with 0xBC */
+const byte format_magic[] = {0xBC, 'Z', 'P'};
+/** Follows format_magic */
+const byte format_version = 1U;
+/** Bytes of format_magic and format_version */
+const size_t format_prefix = sizeof(format_magic) + 1;
 // INJECT/EJECT SIZE ////////////////////////////////////////////////////////////////////////
 template <typename T>
 byte *inject_size(byte *comp, T size)
@@ -33,6 +52,9 @@ byte *inject_size(byte *comp, T size)
 
 uncomp_size_t extract_size(byte *comp, byte **new_ptr);
 
+/** Bytes decoders may write past the end of a phrase */
+const size_t in_place_slack = 16U;
+
 // PACK FUNCTIONS ///////////////////////////////////////////////////////////////////////////
 /**
  * @brief Unpacks parameters
@@ -45,13 +67,29 @@ std::tuple<std::string, size_t, byte*> unpack(byte *data);
 
 std::tuple<char*, uncomp_size_t*, byte*> ptr_unpack(byte *data);
 
+/** Whether data starts with format_magic, false for files of the first format */
+bool versioned(byte *data);
+
+/** The in-place margin stored in the header of data, 0 if unknown */
+uncomp_size_t in_place_margin(byte *data);
+
+/** Stores the in-place margin in the header of data, which must be versioned */
+void set_in_place_margin(byte *data, size_t margin);
+
+/** The checksum block size stored in the header of data, 0 if there are no checksums */
+uncomp_size_t checksum_block(byte *data);
+
+/** Stores the checksum block size in the header of data, which must be versioned */
+void set_checksum_block(byte *data, size_t block_size);
+
 struct pack_info {
 	std::unique_ptr<byte[]> parsing;
 	size_t data_len;
 };
 
 /**
- * @brief Packs the parameters and reserve enough space for the comp. representation
+ * @brief Packs the parameters and reserve enough space for the comp. representation.
+ * The in-place margin is left unknown, and there are no checksums.
  * @param enc_name
  *		The encoder name
  * @param orig_len
@@ -22,7 +22,10 @@
 #include <encoders.hpp>
 #include <utilities.hpp>
 
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace unary_gammalike {
@@ -68,6 +71,23 @@ public:
 		assert(w.writing_head() - start_byte <= std::ceil(1.0 * bits / 8));
 	}
 
+	byte *writing_head()
+	{
+		return w.writing_head();
+	}
+
+	/** Moves the writing head back, after the storage has been moved */
+	void rewind(size_t bytes)
+	{
+		w.rewind(bytes);
+	}
+
+	/** Nothing to do: every value is written as soon as it is encoded */
+	void flush()
+	{
+
+	}
+
 	static double ub_gamma()
 	{
 		assert(cost_class::cost_classes[1] > 1);
@@ -78,7 +98,7 @@ public:
 template <typename cost_class, typename unary_type>
 class decoder {
 private:
-	unaligned_io::reader r;
+	unaligned_io::bit_reader r;
 	unsigned int bits;
 	const static constexpr size_t max_unary   = sizeof(unary_type) * 8U - 1U;
 	const static constexpr size_t unary_bytes = sizeof(unary_type);
@@ -92,35 +112,203 @@ public:
 	template <typename T = unsigned int>
 	T decode()
 	{
-		unary_type read = unary_type();
-		r.peek(read);
+		r.refill();
+		unary_type read = r.lookahead();
 		if (read == unary_type()) {
-			r.skip_bytes(unary_bytes);
+			r.consume(unary_bytes * 8U);
 			return max_unary + gamma_like::decode<cost_class>(r);
 		} else {
 			unsigned int length;
 			unary_suffix_length(read, length);
-			r.skip_bits(length + 1);
+			r.consume(length + 1);
 			return length;
 		}
 	}
+
+	byte *reading_head()
+	{
+		return r.reading_head();
+	}
+};
+
+}
+
+/**
+ * Byte-oriented encoding of the cached graph. Values are packed in groups
+ * of four: a control byte, with two bits per value telling if it takes
+ * 0, 1, 2 or 4 bytes, followed by the little-endian bytes of the values.
+ * Groups are decoded in bulk, with a byte shuffle when the CPU supports it.
+ */
+namespace group_varint {
+
+/** Largest group: control byte plus four 4-bytes values */
+const static constexpr size_t max_group_bytes = 17U;
+
+/**
+ * Decodes groups groups from in into out (4 * groups values), without
+ * reading past limit. Returns the start of the next group.
+ */
+const byte *decode_groups(const byte *in, const byte *limit, std::uint32_t *out, size_t groups);
+
+class encoder {
+private:
+	byte *data;
+	byte *start_byte;
+	size_t bits;
+	std::uint32_t group[4];
+	unsigned int buffered;
+
+	static unsigned int code(std::uint32_t value)
+	{
+		return value == 0 ? 0U : value < (1U << 8) ? 1U : value < (1U << 16) ? 2U : 3U;
+	}
+
+	void write_group()
+	{
+		byte *ctrl = data++;
+		*ctrl = 0U;
+		for (unsigned int i = 0; i < 4; i++) {
+			auto c = code(group[i]);
+			*ctrl |= c << (2 * i);
+			auto bytes = c < 3U ? c : 4U;
+			for (unsigned int j = 0; j < bytes; j++) {
+				*data++ = (group[i] >> (8 * j)) & 0xFF;
+			}
+			group[i] = 0U;
+		}
+		buffered = 0U;
+		assert(data - start_byte <= std::ceil(1.0 * bits / 8));
+	}
+
+public:
+	encoder(byte *storage, size_t bits) : data(storage), start_byte(storage), bits(bits), group(), buffered(0U)
+	{
+
+	}
+
+	template <typename T>
+	void encode(T value)
+	{
+		assert(value <= std::numeric_limits<std::uint32_t>::max());
+		group[buffered++] = value;
+		if (buffered == 4U) {
+			write_group();
+		}
+	}
+
+	/** Writes the values of the last, incomplete group */
+	void flush()
+	{
+		if (buffered > 0U) {
+			write_group();
+		}
+	}
+
+	byte *writing_head()
+	{
+		return data;
+	}
+
+	void rewind(size_t bytes)
+	{
+		data -= bytes;
+	}
+
+	static double ub_gamma()
+	{
+		return 1.0 * max_group_bytes / 4;
+	}
+};
+
+class decoder {
+private:
+	const static constexpr size_t buffered_groups = 16U;
+
+	const byte *data;
+	const byte *limit;
+	std::uint32_t buffer[4 * buffered_groups];
+	unsigned int pos, avail;
+
+	void refill()
+	{
+		assert(data < limit);
+		size_t groups = std::min<size_t>(buffered_groups, (limit - data) / max_group_bytes);
+		groups = std::max<size_t>(groups, 1U);
+		data = decode_groups(data, limit, buffer, groups);
+		pos = 0U;
+		avail = 4 * groups;
+	}
+
+public:
+	decoder(byte *storage, size_t bits) : data(storage), limit(storage + bits / 8), pos(0U), avail(0U)
+	{
+
+	}
+
+	template <typename T = unsigned int>
+	T decode()
+	{
+		if (pos == avail) {
+			refill();
+		}
+		return buffer[pos++];
+	}
+
+	/** Start of the data not yet decoded */
+	byte *reading_head()
+	{
+		return const_cast<byte*>(data);
+	}
 };
 
 }
 
+/** Encoder/decoder pairs of the cached graph */
+struct unary_codec {
+	typedef unary_gammalike::encoder<nibble::class_desc, byte> encoder_t;
+	typedef unary_gammalike::decoder<nibble::class_desc, byte> decoder_t;
+};
+
+struct group_varint_codec {
+	typedef group_varint::encoder encoder_t;
+	typedef group_varint::decoder decoder_t;
+};
+
+/**
+ * Storage of the cached graph: one region of level_size() bytes per level.
+ * By default regions are kept in memory. A file-backed graph is instead
+ * written through per-level chunk buffers, appended to a (unlinked)
+ * temporary file as they fill up, and then memory-mapped for the replays.
+ */
 class cached_graph {
 private:
+	struct spill_state;
+
 	std::shared_ptr<byte> data_hold;
 	byte *end;
 	size_t stride;
+	std::shared_ptr<spill_state> spill_info;
+	/** File-backed graphs: size of the mapping and of each level in it */
+	size_t map_size;
+	size_t level_stride;
+
+	void map_file();
 public:
 	cached_graph()
 	{
 		data_hold.reset();
 		end = data_hold.get();
 		stride = 0;
+		map_size = 0;
+		level_stride = 0;
 	}
 
+	/**
+	 * File-backed graph, whose temporary file lives in spill_dir. Each level
+	 * is written in chunks of chunk_size bytes.
+	 */
+	cached_graph(std::string spill_dir, size_t chunk_size = 1U << 20);
+
 	byte *get_data()
 	{
 		return data_hold.get();
@@ -156,19 +344,34 @@ public:
 		return allocated_size() == 0U;
 	}
 
+	/** Tells if the graph is backed by a file */
+	bool file_backed()
+	{
+		return static_cast<bool>(spill_info);
+	}
+
 	/**
 	 * Allocate storage. level_size is each level's size, in BYTES, while
-	 * levels is the number of levels to cache.
+	 * levels is the number of levels to cache. File-backed graphs can be set
+	 * only until they are sealed.
 	 */
-	void set(size_t level_size, unsigned int levels)
-	{
-		stride = level_size;
-		auto size = levels * stride;
-		data_hold.reset(new byte[size], std::default_delete<byte[]>());
-		auto ptr = data_hold.get();
-		std::fill(ptr, ptr + size, 0U);
-		end = ptr + size;
-	}
+	void set(size_t level_size, unsigned int levels);
+
+	/**
+	 * File-backed graphs only: appends the chunk of level idx to the file
+	 * if the writing head filled it. Returns how many bytes the writer has
+	 * to be moved back (0 if nothing was written).
+	 */
+	size_t spill(unsigned int idx, byte *head);
+
+	/**
+	 * File-backed graphs only: writes the remaining data (heads are the
+	 * writing heads of every level) and maps the file for reading.
+	 */
+	void seal(const std::vector<byte*> &heads);
+
+	/** File-backed graphs only: asks the kernel to read ahead from ptr */
+	void prefetch(byte *ptr);
 };
 
 template <typename inner_gen_t, typename encoder_t>
@@ -179,10 +382,24 @@ private:
 	std::vector<encoder_t> encoders;
 	std::vector<unsigned int> prev_len;
 	std::vector<std::int64_t> prev_pos;
+	size_t t_len;
+
+	/** Writes pending values and, if file-backed, seals the graph */
+	void finish()
+	{
+		std::vector<byte*> heads;
+		for (auto &e : encoders) {
+			e.flush();
+			heads.push_back(e.writing_head());
+		}
+		if (cg->file_backed()) {
+			cg->seal(heads);
+		}
+	}
 public:
 	template <typename inner_gen>
 	caching_fsg_gen(inner_gen &&gen, cached_graph *cg, size_t levels, size_t t_len)
-		: gen(std::forward<inner_gen_t>(gen)), cg(cg), prev_len(levels, 1), prev_pos(levels, -1)
+		: gen(std::forward<inner_gen_t>(gen)), cg(cg), prev_len(levels, 1), prev_pos(levels, -1), t_len(t_len)
 	{
 		auto max_size = std::ceil(encoder_t::ub_gamma() * t_len * 2);
 		cg->set(max_size, levels);
@@ -228,6 +445,15 @@ public:
 	void post_gen()
 	{
 		gen.post_gen();
+		if (cg->file_backed()) {
+			// Move full chunks to the file
+			for (unsigned int i = 0; i < encoders.size(); i++) {
+				encoders[i].rewind(cg->spill(i, encoders[i].writing_head()));
+			}
+		}
+		if (text_pos() == t_len) {
+			finish();
+		}
 	}
 
 	static distance_kind get_kind()
@@ -250,6 +476,10 @@ public:
 template <typename decoder_t>
 class cached_fsg_gen {
 private:
+	/** Read-ahead distance of file-backed graphs, in text positions */
+	const static constexpr unsigned int prefetch_period = 1U << 16;
+
+	cached_graph cg;
 	std::vector<decoder_t> decoders;
 	std::vector<unsigned int> dsts;
 	std::vector<unsigned int> to_ret;
@@ -260,7 +490,7 @@ private:
 	std::vector<std::int64_t> previous_pos;
 public:
 	cached_fsg_gen(cached_graph cg, std::vector<unsigned int> dsts, size_t t_len) 
-		: dsts(dsts), t_pos(0), t_len(t_len), cur_dst_idx(0), previous_len(cg.levels(), 1), previous_pos(cg.levels(), -1)
+		: cg(cg), dsts(dsts), t_pos(0), t_len(t_len), cur_dst_idx(0), previous_len(cg.levels(), 1), previous_pos(cg.levels(), -1)
 	{
 		for (auto i = 0; i < cg.levels(); i++) {
 			decoders.push_back(decoder_t(cg.get_begin(i), cg.level_size() * 8));
@@ -304,6 +534,11 @@ public:
 	void post_gen()
 	{
 		++t_pos;
+		if (t_pos % prefetch_period == 0 && cg.file_backed()) {
+			for (auto &d : decoders) {
+				cg.prefetch(d.reading_head());
+			}
+		}
 	}
 
 	static distance_kind get_kind()
@@ -318,6 +553,9 @@ public:
 
 	cached_fsg_gen(cached_fsg_gen &&other) = default;
 
+	/* Copies are snapshots: they replay the graph from the current position */
+	cached_fsg_gen(const cached_fsg_gen &other) = default;
+
 	cached_fsg_gen &operator=(const cached_fsg_gen &) = delete;
 
 	cached_fsg_gen &operator=(cached_fsg_gen &&) = default;
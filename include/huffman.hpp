@@ -0,0 +1,140 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __HUFFMAN_HPP
+#define __HUFFMAN_HPP
+
+#include <common.hpp>
+#include <unaligned_io.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Block-wise, canonical Huffman coding of byte streams.
+ *
+ * The input is cut into blocks of block_size symbols, each one stored with
+ * its own code or verbatim, whichever is smaller:
+ * - mode (1 byte), number of symbols and of payload bytes (4 bytes each);
+ * - huffman blocks only: the code lengths, 4 bits per symbol;
+ * - the payload.
+ * Codewords are at most max_code_len bits long and written LSB-first, so
+ * that a table indexed by the next max_code_len bits decodes one symbol.
+ */
+namespace huffman {
+
+const unsigned int max_code_len = 11U;
+
+const size_t block_size = 1U << 16;
+
+const size_t block_header_size = 1U + 2U * sizeof(std::uint32_t) + 128U;
+
+/** Bytes that may be read past the end of the encoding */
+const size_t padding = unaligned_io::bit_reader::padding;
+
+enum block_mode : byte {RAW, HUFFMAN};
+
+typedef std::array<std::uint8_t, 256> code_lengths;
+
+/** Lengths (0 for absent symbols) of a length-limited Huffman code for the frequencies */
+code_lengths build_lengths(const std::array<size_t, 256> &freqs);
+
+/** Appends the encoding of src[0, len) to dest */
+void encode(const byte *src, size_t len, std::vector<byte> &dest);
+
+/** Upper bound to the bytes taken by the encoding of len symbols */
+inline size_t max_encoded_len(size_t len)
+{
+	return len + (len / block_size + 1) * block_header_size;
+}
+
+/**
+ * Estimated cost (in bits) of a symbol of text[0, len): the average
+ * codeword length of its code, plus the block headers.
+ */
+double symbol_cost(const byte *text, size_t len);
+
+/** Reads an encoding sequentially, crossing blocks as needed */
+class block_reader {
+private:
+	/** Header of the next block */
+	byte *next_block;
+	/** Symbols of the current block not read yet */
+	size_t left;
+	bool raw;
+	byte *raw_data;
+	unaligned_io::bit_reader bits;
+	/** Entries are symbol | codeword length << 8 */
+	std::array<std::uint16_t, 1U << max_code_len> table;
+
+	void load_block();
+
+	byte *decode(byte *dest, size_t len)
+	{
+		const std::uint64_t mask = (1U << max_code_len) - 1;
+		auto end = dest + len;
+		// A refill gives room for 5 codewords
+		while (end - dest >= 4) {
+			bits.refill();
+			for (unsigned int i = 0; i < 4; i++) {
+				auto entry = table[bits.lookahead() & mask];
+				*dest++ = entry;
+				bits.consume(entry >> 8);
+			}
+		}
+		while (dest < end) {
+			bits.refill();
+			auto entry = table[bits.lookahead() & mask];
+			*dest++ = entry;
+			bits.consume(entry >> 8);
+		}
+		return dest;
+	}
+
+public:
+	block_reader(byte *data) : next_block(data), left(0), raw(true), raw_data(data), bits(data)
+	{
+
+	}
+
+	/** Decodes the next len symbols to dest */
+	void read(byte *dest, size_t len)
+	{
+		while (len > 0) {
+			if (left == 0) {
+				load_block();
+			}
+			auto run = std::min(len, left);
+			if (raw) {
+				std::memcpy(dest, raw_data, run);
+				raw_data += run;
+				dest += run;
+			} else {
+				dest = decode(dest, run);
+			}
+			left -= run;
+			len -= run;
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __MATCH_INTEGRATOR_HPP
+#define __MATCH_INTEGRATOR_HPP
+
+#include <common.hpp>
+#include <cost_model.hpp>
+#include <utilities.hpp>
+#include <wavelet_matrix.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+/**
+ * Integrates parsings of the optimal parser, as solution_integrator does,
+ * without generating the matches of the whole text again.
+ *
+ * Their copy phrases may carry just their distance class (as those of the
+ * cached graph), and be shorter than the maximal edge they come from (cut
+ * at a length class, or rep copies): a phrase of length len in class k at
+ * pos only tells that there is a len-long match at a distance in
+ * (dsts[k - 1], dsts[k]], as shorter ones may have matches in lower classes
+ * too. So:
+ * - a phrase whose own distance matches keeps it (rep copies carry actual
+ *   distances, and those of the following rep copies depend on them);
+ * - otherwise, the match is looked for in the sources of class k only,
+ *   [pos - dsts[k], pos - dsts[k - 1]). The suffixes of that window closest
+ *   in rank to the one at pos have the longest matches: they are found by
+ *   range successor/predecessor queries on a wavelet matrix of the inverse
+ *   suffix array.
+ * Either way, integrated phrases have the classes of the input ones.
+ */
+class match_integrator {
+private:
+	byte *text;
+	size_t t_len;
+	std::vector<unsigned int> dsts;
+	std::shared_ptr<std::vector<std::int32_t>> sa;
+	/** Rank of the suffix at every position */
+	wavelet_matrix isa;
+
+public:
+	match_integrator(text_info ti, sa_getter &sa_get, const cost_model &cm);
+
+	/** Actual distance, in the class of dst, of the len-long copy at pos */
+	unsigned int distance(size_t pos, unsigned int dst, unsigned int len) const;
+
+	template <typename in_t, typename out_t>
+	void integrate(std::vector<in_t> &in, std::vector<out_t> &out)
+	{
+		if (in.size() != out.size()) {
+			throw std::logic_error("Solutions to be fixed and outputs does not match");
+		}
+		for (auto j = 0U; j < in.size(); j++) {
+			for (size_t pos = 0; pos < t_len;) {
+				unsigned int dst, len;
+				byte *data;
+				std::tie(dst, len, data) = in[j].next();
+				if (dst == 0) {
+					out[j].push_lit(len, data, in[j].nextliteral());
+				} else {
+					out[j].push(distance(pos, dst, len), len);
+				}
+				pos += len;
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __MEMORY_PLANNER_HPP
+#define __MEMORY_PLANNER_HPP
+
+#include <cost_model.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** Encodings of the cached graph (see graph_cache.hpp) */
+enum graph_encoding {
+	UNARY_GRAPH,
+	GROUP_VARINT_GRAPH
+};
+
+std::string encoding_name(graph_encoding enc);
+
+/** Estimated peak footprint of a compression run, in bytes */
+struct memory_estimate {
+	/** Code, libraries and allocator bookkeeping */
+	size_t runtime;
+	size_t text;
+	/** Suffix arrays (and inverse) kept alive during the run */
+	size_t suffix_arrays;
+	/** Reduced suffix arrays of the generators */
+	size_t rsa;
+	/** Arrays of the optimal parser */
+	size_t dp;
+	/** Resident part of the cached graph */
+	size_t graph;
+	/** Compressed parsings kept by the bicriteria compressor */
+	size_t parsings;
+
+	memory_estimate() : runtime(8U << 20), text(0), suffix_arrays(0), rsa(0), dp(0), graph(0), parsings(0)
+	{
+
+	}
+
+	size_t total() const
+	{
+		return runtime + text + suffix_arrays + rsa + dp + graph + parsings;
+	}
+};
+
+std::ostream &operator<<(std::ostream &os, const memory_estimate &est);
+
+/** How a bicriteria compression has to run in order to fit a memory budget */
+struct bicriteria_plan {
+	graph_encoding encoding;
+	/** True if the cached graph goes to a temporary file */
+	bool spill;
+	/** Capacity of the cache of compressed parsings */
+	size_t cache_capacity;
+	memory_estimate estimate;
+};
+
+/**
+ * Estimates the memory needed to compress a text of t_len bytes with a cost
+ * model, and picks the settings that make a run fit a given budget. Figures
+ * are upper bounds derived from the sizes of the data structures, not
+ * measurements.
+ */
+class memory_planner {
+private:
+	size_t t_len;
+	std::vector<unsigned int> dst;
+
+	/** Number of levels of the cached graph */
+	size_t graph_levels() const;
+
+public:
+	memory_planner(size_t t_len, const cost_model &cm);
+
+	/** Footprint of the SA, ISA and RSAs of a generator over len bytes */
+	size_t generator_size(size_t len) const;
+
+	/**
+	 * Footprint of a bicriteria compression (solution_getter and
+	 * bicriteria_compressor) with the given settings.
+	 */
+	memory_estimate bicriteria(graph_encoding enc, bool spill, size_t cache_capacity, size_t threads) const;
+
+	/**
+	 * Fastest settings of a bicriteria compression that fit budget bytes,
+	 * spilling the cached graph only if can_spill. Throws std::runtime_error
+	 * if no setting fits.
+	 */
+	bicriteria_plan plan_bicriteria(size_t budget, bool can_spill, size_t threads) const;
+
+	/**
+	 * Footprint of a single-criterion compression (bit_compress), bucketed
+	 * with buckets of bucket_size bytes (0 = no bucketing).
+	 */
+	memory_estimate bucketed(size_t bucket_size) const;
+
+	/**
+	 * Largest bucket size, in bytes and multiple of granularity, whose
+	 * compression fits budget bytes; 0 if the whole text fits. Throws
+	 * std::runtime_error if not even the smallest bucket fits.
+	 */
+	size_t plan_bucket(size_t budget, size_t granularity) const;
+};
+
+/**
+ * Parses a memory size: a number of bytes, optionally followed by
+ * K, M, G or T (powers of 1024).
+ */
+size_t parse_memory_size(const std::string &str);
+
+#endif
@@ -39,6 +39,8 @@ private:
 public:
 
 	typedef Iter iterator;
+	typedef T value_type;
+	typedef typename std::iterator_traits<Iter>::value_type unit_type;
 
 	// Returns an empty RSA (which should not be resized!)
 	rsa() : start_(0) { resize(0); }
@@ -93,6 +95,22 @@ public:
 	{
 		return *begin_;
 	}
+
+	void set(size_t idx, const T &value)
+	{
+		(*this)[idx] = value;
+	}
+
+	/** Storage units taken by a block of the given size (see rsa_queue) */
+	static size_t units(size_t size, size_t)
+	{
+		return size;
+	}
+
+	static rsa make(Iter it, unsigned int level, size_t size, size_t)
+	{
+		return rsa(it, 0, level, size);
+	}
 };
 
 /** RSA splitter implementation */
@@ -222,22 +240,27 @@ public:
 		const auto blocks = std::distance(begin, end);
 
 		// Distribute
+		typename std::iterator_traits<RsaIter>::value_type::value_type entry;
 		for (auto el : parent) {
 			const auto block  = div.get_block(el, off);
 			assert(block < counter.size());
 			assert(block < blocks);
-			div.set_entry(begin[block][counter[block]++], el);
+			div.set_entry(entry, el);
+			begin[block].set(counter[block]++, entry);
 		}
 	}
 };
 
-/** RSA queue */
-template <typename T>
+/**
+ * RSA queue. Blocks are of type block_t, either rsa<std::tuple<T,T>> or
+ * compact_rsa<T>.
+ */
+template <typename T, typename block_t = rsa<std::tuple<T,T>>>
 class rsa_queue {
 private:
-	typedef typename boost::circular_buffer<rsa<std::tuple<T,T>>> rsa_ring;
+	typedef typename boost::circular_buffer<block_t> rsa_ring;
 	// The storage
-	std::vector<std::tuple<T,T>> storage;
+	std::vector<typename block_t::unit_type> storage;
 	// The Suffix Array
 	std::shared_ptr<std::vector<T>> sa;
 	// The queue ring
@@ -283,7 +306,7 @@ private:
 
 public:
 	typedef decltype(queue[0].begin()) iterator;       // Iterator to a sequence of rsa
-	typedef rsa<std::tuple<T,T>> rsa_t;
+	typedef block_t rsa_t;
 
 	rsa_queue() {}
 
@@ -303,7 +326,7 @@ public:
 		for (auto i : descriptor) {
 			unsigned int csize, blocks;
 			std::tie(csize, blocks) = i;
-			storage_needed += csize * blocks;
+			storage_needed += block_t::units(csize, text_len) * blocks;
 		}
 		storage.resize(storage_needed);
 		// Initialize the RSA ring
@@ -315,9 +338,8 @@ public:
 			queue.push_back(rsa_ring(blocks));
 			for (auto j = 0u; j < blocks; j++) {
 				auto &ring = queue.back();
-				rsa_t to_push(it, 0, level, csize);
-				ring.push_back(to_push);
-				std::advance(it, csize);
+				ring.push_back(block_t::make(it, level, csize, text_len));
+				std::advance(it, block_t::units(csize, text_len));
 			}
 			size_map[csize] = level;
 			// std::cout << "Size of level " << level << ": " << csize << std::endl;
@@ -437,21 +459,21 @@ public:
 	}
 
 	// Use the (defaulted) move constructors
-	rsa_queue(const rsa_queue<T> &r) = delete;
-	rsa_queue(rsa_queue<T> &&r) = default;
+	rsa_queue(const rsa_queue &r) = delete;
+	rsa_queue(rsa_queue &&r) = default;
 	// Use move assignment operator
-	rsa_queue<T> &operator=(const rsa_queue<T> &r) = delete;
-	rsa_queue<T> &operator=(rsa_queue<T> &&r) = default;
+	rsa_queue &operator=(const rsa_queue &r) = delete;
+	rsa_queue &operator=(rsa_queue &&r) = default;
 };
 
-/* RSA getter (main class) */
-template <typename T>
+/* RSA getter (main class), see rsa_queue for block_t */
+template <typename T, typename block_t = rsa<std::tuple<T,T>>>
 class rsa_getter {
 public:
-	typedef typename rsa_queue<T>::rsa_t rsa_t;
+	typedef typename rsa_queue<T, block_t>::rsa_t rsa_t;
 private:
 	// Holds the RSA computed so far and not deallocated
-	rsa_queue<T> queue;
+	rsa_queue<T, block_t> queue;
 	// Holds the RSA splitter
 	std::vector<rsa_splitter<T, rsa_div_eq>> splitters;
 	// The text length
@@ -555,7 +577,7 @@ private:
 			}			
 		}
 		// Finally, get the queue.
-		queue = rsa_queue<T>(queue_descriptor, sa);
+		queue = rsa_queue<T, block_t>(queue_descriptor, sa);
 	}
 
 	void initialize_splitters(std::vector<unsigned int> cost_length, bool is_b)
@@ -595,7 +617,7 @@ private:
 		// If we have just one cost class, then we just have to return the SA.
 		if (d_cost_class.size() == 1) {
 			assert(d_cost_class[0] >= t_len);
-			queue = rsa_queue<T>(std::vector<std::tuple<unsigned int, unsigned int>>(), sa);
+			queue = rsa_queue<T, block_t>(std::vector<std::tuple<unsigned int, unsigned int>>(), sa);
 			return;
 		}
 		assert(d_cost_class[d_cost_class.size() - 2] < t_len);
@@ -648,7 +670,7 @@ public:
 	}
 
 	// DEBUG
-	rsa_queue<T> &get_queue()
+	rsa_queue<T, block_t> &get_queue()
 	{
 		return queue;
 	}
@@ -696,9 +718,9 @@ public:
 	}
 
 	// We don't want to perform pricey copies
-	rsa_getter(const rsa_getter<T> &t) = delete;
+	rsa_getter(const rsa_getter &t) = delete;
 
-	rsa_getter(rsa_getter<T> &&t) = default;
+	rsa_getter(rsa_getter &&t) = default;
 
 	/************
 		Gets a getter for W-blocks.
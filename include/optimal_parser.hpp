@@ -17,12 +17,18 @@
 #ifndef __INNER_PARSER_
 #define __INNER_PARSER_
 
+#include <array>
+#include <cstring>
 #include <memory>
 #include <stdint.h>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <memory>
 #include <boost/circular_buffer.hpp>
+#include "parse_arena.hpp"
+#include "phrase_list.hpp"
 #include "cost_model.hpp"
 #include "utilities.hpp"
 #include "encoders.hpp"
@@ -145,8 +151,17 @@ public:
  *		 To support multi-level literal edges, there must be a
  *		 set of plain_t (a vector), with each plain_t remembering
  *		 the minimum and maximum length. For the future, maybe.
+ *
+ * Rep matches: if the cost model has cheaper copies repeating a recent
+ * distance, the state of a position also includes the recent distances of
+ * its best path (see recent_distances()). Edges with those distances take
+ * the cheaper cost, and the matches at those distances are relaxed alongside
+ * the maximal edges. As only the best path of every position is kept, the
+ * parsing is optimal among the paths taking the best way to every position.
+ * The parser keeps track of rep matches only if rep is true (see
+ * parse_with()), so that parsers of models without them pay nothing.
  */
-template <typename fsg_t, typename value_t, typename observer_t>
+template <typename fsg_t, typename value_t, typename observer_t, bool rep = false>
 class optimal_parser {
 private:
 	typedef typename value_t::factory_type v_factory;
@@ -160,19 +175,174 @@ private:
 
 	observer_t observer;
 
+	/** Text position of the next step */
+	size_t position;
+	/** End of the text, and longest copy */
+	size_t text_end;
+	unsigned int max_len;
+	/** Length classes, for the rep matches */
+	std::vector<unsigned int> lens;
+	/**
+	 * Last rep matches found, as (distance, end) pairs: they hold at every
+	 * position up to their end, so matches are scanned once per run
+	 */
+	std::array<std::tuple<std::uint32_t, size_t>, 2> rep_ends;
+	unsigned int next_rep_end;
+
+	/** Copies looked at by recent_distances() */
+	static const unsigned int rep_history = 16U;
+
 //	/** Tells if a position has been visited */
 //	bool unreached(const edge &, const value_t &cost)
 //	{
 //		return value_t() == cost;
 //	}
 
+	void edge_relax(edge_t *sol_edge, value_t *sol_cost, edge_t &gen_edge, const rep_distances &reps = rep_distances())
+    {
+		auto new_cost	= *sol_cost + (rep ? value_fact.get(gen_edge, reps) : value_fact.get(gen_edge));
+		auto next_cost	= std::next(sol_cost, gen_edge.ell);
+		auto next_edge	= std::next(sol_edge, gen_edge.ell);
+
+		if (new_cost < *next_cost) {
+			*next_edge = gen_edge;
+			*next_cost = new_cost;
+//			std::cout << "Setting target cost to " << next_cost->get_value() << std::endl;
+        }
+	}
+
+	void plain_relax(edge_t *sol_edge, value_t *sol_cost, edge_t &gen_edge)
+	{
+		size_t plain_len	= gen_edge.ell;
+		assert(plain_len > 0U);
+		edge_t *source_edge = std::prev(sol_edge, plain_len - 1U);
+		value_t *source_cst	= std::prev(sol_cost, plain_len - 1U);
+		edge_relax(source_edge, source_cst, gen_edge);
+	}
+
+	/** End of the longest match of the next position at distance rep_dst */
+	size_t rep_end(std::uint32_t rep_dst)
+	{
+		for (auto &cached : rep_ends) {
+			if (std::get<0>(cached) == rep_dst && std::get<1>(cached) > position) {
+				return std::get<1>(cached);
+			}
+		}
+		const byte *text_ptr = text.text.get(), *end = text_ptr + text_end;
+		const byte *cur = text_ptr + position, *src = cur - rep_dst;
+		while (cur + sizeof(std::uint64_t) <= end) {
+			std::uint64_t a, b;
+			std::memcpy(&a, cur, sizeof(a));
+			std::memcpy(&b, src, sizeof(b));
+			if (a != b) {
+				// First mismatching byte (assumes a little-endian target)
+				end = cur + (__builtin_ctzll(a ^ b) >> 3);
+				break;
+			}
+			cur += sizeof(std::uint64_t);
+			src += sizeof(std::uint64_t);
+		}
+		while (cur < end && *cur == *src) {
+			++cur;
+			++src;
+		}
+		size_t match_end = cur - text_ptr;
+		rep_ends[next_rep_end] = std::make_tuple(rep_dst, match_end);
+		next_rep_end ^= 1U;
+		return match_end;
+	}
+
+	/**
+	 * Relaxes the rep match of the position at distance rep_dst: as for
+	 * maximal edges, its longest prefix in every length class.
+	 */
+	void rep_relax(edge_t *sol_edge, value_t *sol_cost, std::uint32_t rep_dst, const rep_distances &reps)
+	{
+		if (rep_dst == 0U || rep_dst > position) {
+			return;
+		}
+		auto len = static_cast<unsigned int>(std::min<size_t>(max_len, rep_end(rep_dst) - position));
+		for (auto bound : lens) {
+			auto ell = std::min(bound, len);
+			if (ell == 0) {
+				break;
+			}
+			auto edge = value_fact.model().get_edge(rep_dst, ell);
+			edge_relax(sol_edge, sol_cost, edge, reps);
+			if (ell == len) {
+				break;
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * @brief
+	 *		Recent distances of the path ending with edge: literal runs do not
+	 *		change them. Only the last few copies are looked at.
+	 */
+	static rep_distances recent_distances(const edge_t *edge)
+	{
+		rep_distances reps;
+		for (unsigned int copies = 0; copies < rep_history; copies++) {
+			while (edge->kind() == PLAIN) {
+				edge -= edge->ell;
+			}
+			if (edge->invalid()) {
+				break;
+			}
+			if (reps.last == 0U) {
+				reps.last = edge->d;
+			} else if (edge->d != reps.last) {
+				reps.previous = edge->d;
+				break;
+			}
+			edge -= edge->ell;
+		}
+		return reps;
+	}
+
+	/**
+	 * @brief
+	 *		Tells if two paths have the same copies as far as
+	 *		recent_distances() looks back, so that the recent distances of
+	 *		any extension of them are the same.
+	 */
+	static bool same_recent(const edge_t *edge_1, const edge_t *edge_2)
+	{
+		std::uint32_t last = 0U;
+		for (unsigned int copies = 0; copies < rep_history; copies++) {
+			while (edge_1->kind() == PLAIN) {
+				edge_1 -= edge_1->ell;
+			}
+			while (edge_2->kind() == PLAIN) {
+				edge_2 -= edge_2->ell;
+			}
+			if (edge_1->invalid() || edge_2->invalid()) {
+				return edge_1->invalid() && edge_2->invalid();
+			}
+			if (edge_1->d != edge_2->d) {
+				return false;
+			}
+			if (last == 0U) {
+				last = edge_1->d;
+			} else if (edge_1->d != last) {
+				return true;
+			}
+			edge_1 -= edge_1->ell;
+			edge_2 -= edge_2->ell;
+		}
+		return true;
+	}
+
 	/**
 	 * @brief
 	 *      Reverses the direction of the edges in the optimal path
 	 * @param sol
 	 *      The parsing
 	 */
-	void flip(std::vector<edge_t> &sol)
+	static void flip(std::vector<edge_t> &sol)
 	{
 		// TODO: da controllare. Assumiamo che il path ottimale arrivi fino
 		// all'ultimo edge.
@@ -185,90 +355,154 @@ private:
 		}
 	}
 
-	void edge_relax(edge_t *sol_edge, value_t *sol_cost, edge_t &gen_edge)
-    {
-		auto new_cost	= *sol_cost + value_fact.get(gen_edge);
-		auto next_cost	= std::next(sol_cost, gen_edge.ell);
-		auto next_edge	= std::next(sol_edge, gen_edge.ell);
-
-		if (new_cost < *next_cost) {
-			*next_edge = gen_edge;
-			*next_cost = new_cost;
-//			std::cout << "Setting target cost to " << next_cost->get_value() << std::endl;
-        }
+	/**
+	 * @brief
+	 *		Allocates the parsing of a text, taking it from the arena if any
+	 */
+	static std::vector<edge_t> get_parsing(size_t sol_len, parse_arena *arena)
+	{
+		return arena != nullptr ? arena->parsing(sol_len) : std::vector<edge_t>(sol_len);
 	}
 
-	void plain_relax(edge_t *sol_edge, value_t *sol_cost, edge_t &gen_edge)
+	/**
+	 * @brief
+	 *		Allocates the costs of a parse, all unreached but the first one
+	 * @param own_cost
+	 *		Holds the costs if there is no arena
+	 */
+	static value_t *get_costs(size_t sol_len, parse_arena *arena, std::vector<value_t> &own_cost)
 	{
-		size_t plain_len	= gen_edge.ell;
-		assert(plain_len > 0U);
-		edge_t *source_edge = std::prev(sol_edge, plain_len - 1U);
-		value_t *source_cst	= std::prev(sol_cost, plain_len - 1U);
-		edge_relax(source_edge, source_cst, gen_edge);
+		value_t *p_cost;
+		if (arena != nullptr) {
+			static_assert(std::is_trivially_destructible<value_t>::value, "Costs in the arena are never destroyed");
+			p_cost = arena->costs<value_t>(sol_len);
+			std::uninitialized_fill_n(p_cost, sol_len, value_t());
+		} else {
+			own_cost.resize(sol_len);
+			p_cost = own_cost.data();
+		}
+		p_cost[0].zero();
+		return p_cost;
 	}
 
-public:
-
+	/**
+	 * @param start
+	 *		Text position of the first step (or fed literal); text.len is the
+	 *		length of the text from there on
+	 */
     template <typename T>
     optimal_parser(
             T &&fsg,
 			size_t plain_range,
 			v_factory value_fact,
 			text_info text,
-			observer_t observer
+			observer_t observer,
+			size_t start = 0U
 	)
 		: fsg(std::forward<T>(fsg)), value_fact(value_fact), plain_gen(text.len, plain_range, value_fact),
-		  max_edges(this->fsg.get_edges()), text(text), observer(observer)
+		  max_edges(this->fsg.get_edges()), text(text), observer(observer),
+		  position(start), text_end(start + text.len), max_len(value_fact.model().get_len().back()),
+		  lens(value_fact.model().get_len()), next_rep_end(0U)
     {
+		rep_ends.fill(std::make_tuple(0U, 0U));
+		assert(rep == value_fact.has_rep());
 		assert(max_edges.size() > 0);
 		back_edge = plain_gen.get_edge();
 		assert(back_edge != nullptr);
     }
 
-	std::vector<edge_t> parse(double *cost)
+	/**
+	 * @brief
+	 *		Processes the next position: relaxes its maximal edges and the
+	 *		literal edge ending right after it.
+	 * @param cur
+	 *		Edge of the position; the following ones are at std::next(&cur, k)
+	 * @param cur_cst
+	 *		Cost of the position; the following ones are at std::next(&cur_cst, k)
+	 * @return
+	 *		The length of the longest maximal edge relaxed (0 if none)
+	 */
+	inline unsigned int step(edge_t &cur, value_t &cur_cst)
+	{
+		unsigned int generated	= 0;
+		// By protocol, the following two functions must be invoked for each position.
+		fsg.gen_next(&generated);
+		plain_gen.gen_next(cur_cst); // TODO: take the one provided by back_relaxer as plain_edge
+//		if (unreached(cur, cur_cst)) {
+//			return;
+//		}
+		// The position is final: so are the recent distances of its path
+		auto reps = rep ? recent_distances(&cur) : rep_distances();
+		if (generated > 0) {
+			auto edge_ptr = max_edges.begin();
+			for (unsigned int j = 0; j < generated; j++) {
+//				std::cout << "Current edge to be evaluated: " << edge_ptr-> d << "\t" << edge_ptr->ell;
+//				std::cout << ", cost: " << value_fact.get(*edge_ptr).get_value() << std::endl;
+				edge_relax(&cur, &cur_cst, *edge_ptr++, reps);
+			}
+		}
+		if (rep) {
+			rep_relax(&cur, &cur_cst, reps.last, reps);
+			rep_relax(&cur, &cur_cst, reps.previous, reps);
+		}
+//		std::cout << "Plain edge to be evaluated: " << back_edge->d << "\t" << back_edge->ell;
+//		std::cout << ", cost: " << value_fact.get(*back_edge).get_value() << std::endl;
+		plain_relax(&cur, &cur_cst, *back_edge);
+		++position;
+		return generated > 0 ? max_edges[generated - 1].ell : 0U;
+	}
+
+	/**
+	 * @brief
+	 *		Feeds the literal window with the (final) cost of a position which
+	 *		precedes the first one processed by step().
+	 */
+	inline void feed_literal(value_t cur_cst)
+	{
+		plain_gen.gen_next(cur_cst);
+		++position;
+	}
+
+	/**
+	 * @brief
+	 *		Turns the edges of a parse into a phrase list, which keeps the
+	 *		storage of the edges only if it goes back to an arena
+	 */
+	static phrase_list get_phrases(std::vector<edge_t> &&parsing, parse_arena *arena)
+	{
+		flip(parsing);
+		phrase_list to_ret(std::move(parsing));
+		if (arena == nullptr) {
+			to_ret.shrink_to_fit();
+		}
+		return to_ret;
+	}
+
+	/**
+	 * @param arena
+	 *		If not null, provides the buffers of the parse (see parse_arena.hpp)
+	 */
+	phrase_list parse(double *cost, parse_arena *arena = nullptr)
     {
 		// Allocates the solution and the costs vector
 		const size_t sol_len = text.len + 1;
-		std::vector<edge_t> parsing(sol_len);
-		std::vector<value_t> p_cost(sol_len);
-		p_cost.front().zero();
+		auto parsing = get_parsing(sol_len, arena);
+		std::vector<value_t> own_cost;
+		auto p_cost = get_costs(sol_len, arena, own_cost);
 
-		unsigned int generated	= 0;
 //		auto next_pos			= parsing.begin();
 //		auto next_cost			= p_cost.begin();
 
 		for (unsigned int i = 0; i < text.len; i++) {
-			auto &cur		= parsing[i];
-			auto &cur_cst	= p_cost[i];
-
-//			std::cout << "==== Processing vertex " << i << ", current cost: " << cur_cst.get_value() << std::endl;
-
-            // By protocol, the following two functions must be invoked for each position.
-            fsg.gen_next(&generated);
-			plain_gen.gen_next(cur_cst); // TODO: take the one provided by back_relaxer as plain_edge
-//			if (unreached(cur, cur_cst)) {
-//				continue;
-//			}
-			if (generated > 0) {
-				auto edge_ptr = max_edges.begin();
-				for (unsigned int j = 0; j < generated; j++) {
-//					std::cout << "Current edge to be evaluated: " << edge_ptr-> d << "\t" << edge_ptr->ell;
-//					std::cout << ", cost: " << value_fact.get(*edge_ptr).get_value() << std::endl;
-					edge_relax(&cur, &cur_cst, *edge_ptr++);
-				}
-			}
-//			std::cout << "Plain edge to be evaluated: " << back_edge->d << "\t" << back_edge->ell;
-//			std::cout << ", cost: " << value_fact.get(*back_edge).get_value() << std::endl;
-			plain_relax(&cur, &cur_cst, *back_edge);
-
+//			std::cout << "==== Processing vertex " << i << ", current cost: " << p_cost[i].get_value() << std::endl;
+			step(parsing[i], p_cost[i]);
 			observer.new_character();
         }
-		flip(parsing);
 //		for (auto i : parsing) {
 //			std::cout << i.d << "\t" << i.ell << std::endl;
 //		}
-		*cost = p_cost.back().get_value();
-		return std::move(parsing);
+		*cost = p_cost[text.len].get_value();
+		return get_phrases(std::move(parsing), arena);
     }
 };
 
@@ -309,42 +543,55 @@ void operator()(cost_model cm, size_t literal_window)
 #endif
 
 /********************* MAIN FUNCTIONS **********************************/
+/**
+ * Parses with the parser keeping track of rep matches only if the value
+ * factory has rep costs
+ */
+template <typename value_t, typename fsg_t, typename observer_t>
+phrase_list parse_with(text_info text, fsg_t &&fsg, size_t literal_window, typename value_t::factory_type value_factory,
+					   double *cost, observer_t observer, parse_arena *arena)
+{
+	if (value_factory.has_rep()) {
+		optimal_parser<fsg_t, value_t, observer_t, true> parser(std::forward<fsg_t>(fsg), literal_window, value_factory, text, observer);
+		return parser.parse(cost, arena);
+	}
+	optimal_parser<fsg_t, value_t, observer_t, false> parser(std::forward<fsg_t>(fsg), literal_window, value_factory, text, observer);
+	return parser.parse(cost, arena);
+}
+
 template <typename fsg_t, typename observer_t>
-std::vector<edge_t> parse(text_info text, fsg_t &&fsg, size_t literal_window,
-						  cost_model cm, double *cost, observer_t observer)
+phrase_list parse(text_info text, fsg_t &&fsg, size_t literal_window,
+						  cost_model cm, double *cost, observer_t observer, parse_arena *arena = nullptr)
 {
 #ifndef NDEBUG
 	print_cm()(cm, literal_window);
 #endif
 	// (a) Obtain the value factory
 	ec_factory value_factory(cm);
-	// (b) instantiate the optimal parser
-	optimal_parser<fsg_t, edge_cost, observer_t> parser(std::forward<fsg_t>(fsg), literal_window, value_factory, text, observer);
-	// (c) return the parsing
-	return parser.parse(cost);
+	// (b) instantiate the optimal parser and (c) return the parsing
+	return parse_with<edge_cost>(text, std::forward<fsg_t>(fsg), literal_window, value_factory, cost, observer, arena);
 }
 
 template <typename fsg_t, typename observer_t>
-std::vector<edge_t> bi_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
-									   cost_model cost_cm, cost_model weight_cm, double *cost, observer_t observer)
+phrase_list bi_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
+									   cost_model cost_cm, cost_model weight_cm, double *cost, observer_t observer,
+									   parse_arena *arena = nullptr)
 {
 	// (a) Obtain the value factory
 	bi_factory value_factory(cost_cm, weight_cm);
-	// (b) instantiate the optimal parser
-	optimal_parser<fsg_t, bi_edge_cost, observer_t> parser(std::forward<fsg_t>(fsg), literal_window, value_factory, text, observer);
-	// (c) return the parsing
-	return parser.parse(cost);
+	// (b) instantiate the optimal parser and (c) return the parsing
+	return parse_with<bi_edge_cost>(text, std::forward<fsg_t>(fsg), literal_window, value_factory, cost, observer, arena);
 }
 
 template <typename fsg_t, typename observer_t>
-std::vector<edge_t> cost_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
+phrase_list cost_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
 									   cost_model cost_cm, cost_model weight_cm, double *cost, observer_t observer)
 {
 	return bi_optimal_parse(text, std::forward<fsg_t>(fsg), literal_window, cost_cm, weight_cm, cost, observer);
 }
 
 template <typename fsg_t, typename observer_t>
-std::vector<edge_t> weight_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
+phrase_list weight_optimal_parse(text_info text, fsg_t &&fsg, size_t literal_window,
 										 cost_model cost_cm, cost_model weight_cm, double *cost, observer_t observer)
 {
 	return bi_optimal_parse(text, std::forward<fsg_t>(fsg), literal_window, weight_cm, cost_cm, cost, observer);
@@ -0,0 +1,401 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef PARALLEL_PARSER_HPP
+#define PARALLEL_PARSER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <graph_cache.hpp>
+#include <meter_printer.hpp>
+#include <optimal_parser.hpp>
+
+/**
+ * Splits the text of a cached graph in segments to be parsed in parallel.
+ * Segment boundaries are placed on cut positions, that is positions which no
+ * maximal edge crosses. When cuts are sparse, a boundary is placed anyway
+ * (speculative boundary) after a slack of a quarter of segment.
+ * A snapshot of the graph decoder is kept for every boundary.
+ * Cuts depend on the classes of the cost model (see fits()).
+ */
+template <typename decoder_t = unary_gammalike::decoder<nibble::class_desc, byte>>
+class graph_cuts {
+public:
+	typedef cached_fsg_gen<decoder_t> gen_t;
+private:
+	std::vector<size_t> bounds;
+	/** Farthest end of the maximal edges starting before each bound */
+	std::vector<size_t> reach;
+	std::vector<gen_t> snapshots;
+	/** Distance classes and longest copy of the cost model */
+	std::vector<unsigned int> dst;
+	unsigned int max_len;
+
+public:
+	graph_cuts(cached_graph cg, const cost_model &cm, size_t t_len, size_t segments)
+		: dst(cm.get_dst()), max_len(cm.get_len().back())
+	{
+		gen_t g(cg, dst, t_len);
+		size_t seg_len = std::max<size_t>(1U, t_len / std::max<size_t>(1U, segments));
+		size_t slack = seg_len / 4;
+		size_t farthest = 0U;
+		for (size_t i = 0; i < t_len; i++) {
+			size_t target = bounds.size() * seg_len;
+			if (i >= target && (farthest <= i || i >= target + slack)) {
+				bounds.push_back(i);
+				reach.push_back(farthest);
+				snapshots.push_back(g);
+			}
+			// Same decoding pattern of fsg_protocol::generate_edges
+			g.pre_gen();
+			auto levels = g.levels();
+			for (unsigned int l = 0; l < levels; l++) {
+				unsigned int ell = std::get<1>(g.max_match(l));
+				farthest = std::max<size_t>(farthest, i + std::min(ell, max_len));
+				if (ell >= max_len) {
+					break;
+				}
+			}
+			g.post_gen();
+		}
+		bounds.push_back(t_len);
+		reach.push_back(farthest);
+	}
+
+	/** Tells if the cuts hold for the edges of a cost model */
+	bool fits(const cost_model &cm) const
+	{
+		return cm.get_dst() == dst && cm.get_len().back() == max_len;
+	}
+
+	/** Number of segments */
+	size_t size() const
+	{
+		return snapshots.size();
+	}
+
+	size_t begin(size_t idx) const
+	{
+		return bounds[idx];
+	}
+
+	size_t end(size_t idx) const
+	{
+		return bounds[idx + 1];
+	}
+
+	/** Tells if no maximal edge crosses the beginning of the segment */
+	bool is_cut(size_t idx) const
+	{
+		return reach[idx] <= bounds[idx];
+	}
+
+	/** Farthest end of the maximal edges starting before the segment */
+	size_t reach_in(size_t idx) const
+	{
+		return reach[idx];
+	}
+
+	/** Farthest end of the maximal edges starting before the end of the segment */
+	size_t reach_out(size_t idx) const
+	{
+		return std::max(reach[idx + 1], bounds[idx + 1]);
+	}
+
+	/** A generator replaying the graph from the beginning of the segment */
+	gen_t get_gen(size_t idx) const
+	{
+		return snapshots[idx];
+	}
+};
+
+/** cost rounded to a multiple of 2^-cost_grid_bits, if below exact_cost_bound (see edges.hpp) */
+inline double grid_cost(double cost)
+{
+	return cost < exact_cost_bound ? std::ldexp(std::round(std::ldexp(cost, cost_grid_bits)), -cost_grid_bits) : cost;
+}
+
+/**
+ * The cost model cm with its costs rounded by grid_cost: the costs of its
+ * edges, literal runs included, lie on the grid. Models with integer costs,
+ * as space models, are unchanged.
+ */
+inline cost_model on_grid(const cost_model &cm)
+{
+	auto costs = cm.get_cm();
+	for (auto i = 0U; i < costs.dsts(); i++) {
+		for (auto j = 0U; j < costs.lens(); j++) {
+			costs(i, j) = grid_cost(costs(i, j));
+		}
+	}
+	double lit_fixed = grid_cost(cm.lit_cost(0)), lit_var = grid_cost(cm.lit_cost(1) - cm.lit_cost(0));
+	cost_model to_ret(cm.get_dst(), cm.get_len(), costs, lit_fixed, lit_var, cm.cost_per_char());
+	if (cm.has_rep()) {
+		std::vector<double> reps;
+		for (auto len : cm.get_len()) {
+			reps.push_back(grid_cost(cm.rep_cost(len)));
+		}
+		to_ret.set_rep_costs(reps);
+	}
+	return to_ret;
+}
+
+/**
+ * Exact parallel optimal parser over a cached graph: given cost models on
+ * the grid (see on_grid()), the parsing is the same of the sequential parser.
+ *
+ * Every segment is parsed in parallel as if it started the text (speculative
+ * run). Then, segments are fixed-up in order: the DP is resumed from the true
+ * state at the segment beginning (literal window and maximal edges coming
+ * from the previous segment) until it agrees with the speculative run, that
+ * is over more than a literal window of consecutive positions:
+ * - same edges and the same cost offset;
+ * - with rep matches, the same copies as far as the recent distances look
+ *   back (see optimal_parser::same_recent());
+ * - no maximal edge from before them crossing the last one.
+ * From there on the DP state is the speculative one plus the offset, so its
+ * edges are spliced in and costs are re-accumulated along them exactly as
+ * the sequential parser does.
+ * Offsets are compared exactly: edge costs lie on a grid whose sums are exact
+ * (see edges.hpp), so adding an offset preserves every comparison. If the
+ * costs of the text may exceed the exact range, nothing is spliced and the
+ * text is parsed sequentially; if no agreement happens, the segment is
+ * entirely parsed by the fix-up.
+ * As for optimal_parser, rep matches are kept track of only if rep is true.
+ */
+template <typename value_t, typename decoder_t, typename observer_t, bool rep = false>
+class parallel_parser {
+private:
+	typedef typename value_t::factory_type v_factory;
+	typedef typename graph_cuts<decoder_t>::gen_t gen_t;
+	typedef fsg_protocol<gen_t> fsg_t;
+	typedef optimal_parser<fsg_t, value_t, empty_observer, rep> parser_t;
+
+	struct segment {
+		std::vector<edge_t> parsing;
+		std::vector<value_t> cost;
+	};
+
+	const graph_cuts<decoder_t> &cuts;
+	v_factory value_fact;
+	size_t literal_window;
+	text_info text;
+	std::vector<unsigned int> dst;
+	std::vector<unsigned int> len;
+	observer_t observer;
+	/** Workers of the speculative runs */
+	size_t threads;
+	/** True if all the costs of the parse are exact sums (see edges.hpp) */
+	bool exact;
+
+	std::unique_ptr<parser_t> get_parser(size_t idx, size_t from) const
+	{
+		fsg_t fsg(cuts.get_gen(idx), text.len, dst, len);
+		text_info remaining(text.text, text.len - from);
+		return make_unique<parser_t>(std::move(fsg), literal_window, value_fact, remaining, empty_observer(), from);
+	}
+
+	segment speculate(size_t idx) const
+	{
+		size_t begin = cuts.begin(idx), end = cuts.end(idx);
+		size_t size = cuts.reach_out(idx) - begin + 1;
+		segment s{std::vector<edge_t>(size), std::vector<value_t>(size)};
+		s.cost.front().zero();
+		auto parser = get_parser(idx, begin);
+		for (size_t i = 0; i < end - begin; i++) {
+			parser->step(s.parsing[i], s.cost[i]);
+		}
+		return s;
+	}
+
+	static bool same_edge(const edge_t &e_1, const edge_t &e_2)
+	{
+		return e_1.d == e_2.d && e_1.ell == e_2.ell && e_1.cost_id == e_2.cost_id;
+	}
+
+	/** Tells if the DP states of two positions agree (but for the cost offset) */
+	bool same_state(const edge_t &e_1, const edge_t &e_2) const
+	{
+		return same_edge(e_1, e_2) && (!rep || parser_t::same_recent(&e_1, &e_2));
+	}
+
+	/** Splices positions [from, begin + s.size()) of the speculative run */
+	void splice(segment &s, size_t begin, size_t from, std::vector<edge_t> &parsing, value_t *p_cost)
+	{
+		for (size_t j = from; j < begin + s.cost.size(); j++) {
+			auto &edge = s.parsing[j - begin];
+			if (s.cost[j - begin] == value_t()) {
+				continue; // Not reached yet
+			}
+			parsing[j] = edge;
+			auto reps = rep ? parser_t::recent_distances(&parsing[j - edge.ell]) : rep_distances();
+			p_cost[j] = p_cost[j - edge.ell] + value_fact.get(edge, reps);
+		}
+	}
+
+	/** Speculative runs of the segments from the next one on, until none is left */
+	void speculate_all(std::vector<std::promise<segment>> &runs, std::atomic<size_t> &next) const
+	{
+		for (size_t i = next++; i < runs.size(); i = next++) {
+			try {
+				runs[i].set_value(speculate(i));
+			} catch (...) {
+				runs[i].set_exception(std::current_exception());
+			}
+		}
+	}
+
+	void fix_up(size_t idx, segment &s, std::vector<edge_t> &parsing, value_t *p_cost)
+	{
+		size_t begin = cuts.begin(idx), end = cuts.end(idx);
+		if (begin == 0U) {
+			splice(s, begin, begin + 1, parsing, p_cost);
+			return;
+		}
+		// Restore the literal window at the beginning of the segment
+		size_t from = begin - std::min(literal_window, begin);
+		auto parser = get_parser(idx, from);
+		for (size_t i = from; i < begin; i++) {
+			parser->feed_literal(p_cost[i]);
+		}
+
+		value_t delta;
+		size_t agree = 0U;
+		// Farthest end of the maximal edges relaxed so far, and before the agreeing positions
+		size_t reach = cuts.reach_in(idx), agree_reach = reach;
+		for (size_t i = begin; i < end; i++) {
+			reach = std::max<size_t>(reach, i + parser->step(parsing[i], p_cost[i]));
+			// Position i + 1 is final: compare it with the speculative run
+			size_t j = i + 1 - begin;
+			if (!same_state(parsing[i + 1], s.parsing[j])) {
+				agree = 0U;
+				continue;
+			}
+			auto offset = p_cost[i + 1] - s.cost[j];
+			if (agree > 0U && offset == delta) {
+				++agree;
+			} else {
+				agree = 1U;
+				delta = offset;
+				agree_reach = reach;
+			}
+			if (agree > literal_window && agree_reach <= i + 1) {
+				splice(s, begin, i + 2, parsing, p_cost);
+				return;
+			}
+		}
+	}
+
+public:
+	parallel_parser(
+		const graph_cuts<decoder_t> &cuts, size_t literal_window, v_factory value_fact,
+		const cost_model &cm, text_info text, observer_t observer, size_t threads
+	)
+		: cuts(cuts), value_fact(value_fact), literal_window(literal_window), text(text),
+		  dst(cm.get_dst()), len(cm.get_len()), observer(observer), threads(std::max<size_t>(1U, threads))
+	{
+		assert(cuts.fits(cm));
+		// Prefix costs are at most those of all-literal paths, and the literal
+		// window adds a penalty of the same order to them
+		exact = value_fact.get(edge_t(1)).exact(2 * text.len + 2);
+	}
+
+	/** The arena, if any, provides the buffers of the whole text (not those of the segments) */
+	phrase_list parse(double *cost, parse_arena *arena = nullptr)
+	{
+		const size_t sol_len = text.len + 1;
+		auto parsing = parser_t::get_parsing(sol_len, arena);
+		std::vector<value_t> own_cost;
+		auto p_cost = parser_t::get_costs(sol_len, arena, own_cost);
+
+		if (!exact) {
+			// Agreement could not be proven: parse sequentially
+			auto parser = get_parser(0, 0);
+			for (size_t i = 0; i < cuts.size(); i++) {
+				for (size_t j = cuts.begin(i); j < cuts.end(i); j++) {
+					parser->step(parsing[j], p_cost[j]);
+				}
+				observer.set_character(cuts.end(i));
+			}
+			*cost = p_cost[text.len].get_value();
+			return parser_t::get_phrases(std::move(parsing), arena);
+		}
+		// (a) Speculative runs, in segment order on at most threads workers
+		std::vector<std::promise<segment>> runs(cuts.size());
+		std::atomic<size_t> next(0U);
+		std::vector<std::future<void>> workers;
+		for (size_t t = 0; t < std::min(threads, cuts.size()); t++) {
+			workers.push_back(std::async(std::launch::async, &parallel_parser::speculate_all, this, std::ref(runs), std::ref(next)));
+		}
+		// (b) Fix-up pass, overlapped with the remaining speculative runs
+		for (size_t i = 0; i < cuts.size(); i++) {
+			auto s = runs[i].get_future().get();
+			fix_up(i, s, parsing, p_cost);
+			observer.set_character(cuts.end(i));
+		}
+		*cost = p_cost[text.len].get_value();
+		return parser_t::get_phrases(std::move(parsing), arena);
+	}
+};
+
+/********************* MAIN FUNCTIONS **********************************/
+/** As parse_with(), for the parallel parser */
+template <typename value_t, typename decoder_t, typename observer_t>
+phrase_list parallel_parse_with(text_info text, const graph_cuts<decoder_t> &cuts, size_t threads, size_t literal_window,
+								typename value_t::factory_type value_factory, const cost_model &cm, double *cost,
+								observer_t observer, parse_arena *arena)
+{
+	if (value_factory.has_rep()) {
+		parallel_parser<value_t, decoder_t, observer_t, true> parser(cuts, literal_window, value_factory, cm, text, observer, threads);
+		return parser.parse(cost, arena);
+	}
+	parallel_parser<value_t, decoder_t, observer_t, false> parser(cuts, literal_window, value_factory, cm, text, observer, threads);
+	return parser.parse(cost, arena);
+}
+
+/**
+ * Parses in parallel with the costs of cm rounded to the grid (see
+ * on_grid()): the parsing is optimal for the rounded costs, which are those
+ * of cm for models with integer costs. The speculative runs take at most
+ * threads workers, while the calling thread fixes up the segments.
+ */
+template <typename decoder_t, typename observer_t>
+phrase_list parallel_parse(text_info text, const graph_cuts<decoder_t> &cuts, size_t threads, size_t literal_window,
+								   cost_model cm, double *cost, observer_t observer, parse_arena *arena = nullptr)
+{
+	auto grid_cm = on_grid(cm);
+	ec_factory value_factory(grid_cm);
+	return parallel_parse_with<edge_cost>(text, cuts, threads, literal_window, value_factory, grid_cm, cost, observer, arena);
+}
+
+template <typename decoder_t, typename observer_t>
+phrase_list parallel_bi_optimal_parse(text_info text, const graph_cuts<decoder_t> &cuts, size_t threads, size_t literal_window,
+											  cost_model cost_cm, cost_model weight_cm, double *cost, observer_t observer,
+											  parse_arena *arena = nullptr)
+{
+	auto grid_cost_cm = on_grid(cost_cm);
+	bi_factory value_factory(grid_cost_cm, on_grid(weight_cm));
+	return parallel_parse_with<bi_edge_cost>(text, cuts, threads, literal_window, value_factory, grid_cost_cm, cost, observer, arena);
+}
+
+#endif // PARALLEL_PARSER_HPP
@@ -0,0 +1,76 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __PARSE_ARENA_HPP
+#define __PARSE_ARENA_HPP
+
+#include <common.hpp>
+#include <phrase_list.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Buffers of the optimal parser, kept across parses of the same text.
+ *
+ * A parse needs a parsing and a cost for every position: allocating them
+ * afresh every time means page-faulting them in again, which on large
+ * texts takes a sizeable share of a parse. The arena instead keeps:
+ * - the costs in a single block backed by huge pages where available,
+ *   grown when needed and reused by the next parse;
+ * - the parsings given back by recycle(), handed out again by parsing().
+ * Not thread-safe: a single parse at a time.
+ */
+class parse_arena {
+private:
+	byte *block;
+	size_t block_size;
+	std::vector<std::vector<edge_t>> parsings;
+
+	void unmap();
+
+public:
+	parse_arena();
+
+	parse_arena(const parse_arena &) = delete;
+	parse_arena &operator=(const parse_arena &) = delete;
+
+	~parse_arena();
+
+	/** A parsing of len default edges, reusing a recycled one if any */
+	std::vector<edge_t> parsing(size_t len);
+
+	/** Gives back the storage of a parsing which is no longer needed */
+	void recycle(phrase_list &&parsing);
+
+	/**
+	 * Uninitialized storage for bytes bytes, aligned to a page. It stays
+	 * valid until the next call or release().
+	 */
+	void *reserve(size_t bytes);
+
+	/** Uninitialized storage for len values of type T (see reserve()) */
+	template <typename T>
+	T *costs(size_t len)
+	{
+		return static_cast<T*>(reserve(len * sizeof(T)));
+	}
+
+	/** Frees every buffer, e.g. once the parses are done */
+	void release();
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <cost_model.hpp>
 #include <phrase_reader.hpp>
 #include <common.hpp>
+#include <phrase_list.hpp>
 
 #include <cppformat/format.h>
 
@@ -52,7 +53,7 @@ public:
 
 	}
 
-	virtual std::vector<edge_t> swap(double W, double *cost = nullptr) = 0;
+	virtual phrase_list swap(double W, double *cost = nullptr) = 0;
 
 	virtual ~swapper()
 	{
@@ -183,10 +184,10 @@ private:
 		return std::make_tuple(swap_sol, swap_point);
 	}
 
-	std::vector<edge_t> generate(unsigned int first_idx, unsigned int swap_point)
+	phrase_list generate(unsigned int first_idx, unsigned int swap_point)
 	{
 		auto L = parsings[0].orig_len;
-		std::vector<edge_t> to_ret(L + 1);
+		phrase_list to_ret;
 
 		std::array<lzopt::phrase_reader<enc_t>, 2> readers = {{
 			lzopt::phrase_reader<enc_t>(parsings[0].begin, parsings[0].comp_len),
@@ -199,7 +200,7 @@ private:
 		while (pos < swap_point) {
 			readers[cur_sol].next(d, len);
 			assert((d > 0 && len > 0) || (d == 0 && len > 0));
-			to_ret[pos] = cost_cm.get_edge(d, len);
+			to_ret.push_back(cost_cm.get_edge(d, len));
 			pos += len;
 		}
 
@@ -210,15 +211,16 @@ private:
 			pos += len;
 		}
 
-		to_ret[swap_point] = cost_cm.get_edge(d, pos - swap_point);
-		
+		if (pos > swap_point) {
+			to_ret.push_back(cost_cm.get_edge(d, pos - swap_point));
+		}
+
 		while (pos < L) {
 			readers[cur_sol].next(d, len);
 			assert((d > 0 && len > 0) || (d == 0 && len > 0));
-			to_ret[pos] = cost_cm.get_edge(d, len);
+			to_ret.push_back(cost_cm.get_edge(d, len));
 			pos += len;
 		}
-		to_ret[L] = cost_cm.get_edge(d, len);
 		return to_ret;
 	}
 
@@ -235,7 +237,7 @@ public:
 	}
 
 
-	std::vector<edge_t> swap(double W, double *cost = nullptr)
+	phrase_list swap(double W, double *cost = nullptr)
 	{
 		// First: get swapping point 
 		unsigned int first_idx, swap_position;
@@ -250,7 +252,7 @@ public:
 	}
 };
 
-std::vector<edge_t> path_swap(
+phrase_list path_swap(
 		std::string encoder_name,
 		parsing p_1, double cost_1, double weight_1,
 		parsing p_2, double cost_2, double weight_2,
@@ -0,0 +1,121 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __PHRASE_LIST_HPP
+#define __PHRASE_LIST_HPP
+
+#include <common.hpp>
+
+#include <utility>
+#include <vector>
+
+/**
+ * A parsing as the sequence of its phrases, in text order.
+ *
+ * The optimal parser works on an edge per text position, and only the
+ * edges starting a phrase are meaningful once the parsing is flipped:
+ * keeping just those takes a fraction of the space (a phrase is several
+ * bytes long, on average) and makes a scan of the parsing a dense one.
+ */
+class phrase_list {
+private:
+	std::vector<edge_t> phrases;
+	/** Sum of the phrase lengths */
+	size_t text_len;
+
+public:
+	typedef std::vector<edge_t>::const_iterator const_iterator;
+
+	phrase_list() : text_len(0U)
+	{
+
+	}
+
+	/**
+	 * Takes the phrases of a flipped parsing of a text of sol.size() - 1
+	 * bytes, where the edge of every phrase is at its starting position.
+	 * Phrases are compacted in place: sol keeps its capacity.
+	 */
+	explicit phrase_list(std::vector<edge_t> &&sol) : phrases(std::move(sol)), text_len(0U)
+	{
+		const auto len = phrases.empty() ? 0U : phrases.size() - 1;
+		size_t count = 0;
+		while (text_len < len) {
+			auto edge = phrases[text_len];
+			phrases[count++] = edge;
+			text_len += edge.ell;
+		}
+		phrases.resize(count);
+	}
+
+	void push_back(const edge_t &phrase)
+	{
+		phrases.push_back(phrase);
+		text_len += phrase.ell;
+	}
+
+	void reserve(size_t phrases_)
+	{
+		phrases.reserve(phrases_);
+	}
+
+	/** Drops the capacity left over by the edges of the parser */
+	void shrink_to_fit()
+	{
+		phrases.shrink_to_fit();
+	}
+
+	/** Hands out the storage (e.g. to a parse_arena), leaving the list empty */
+	std::vector<edge_t> release()
+	{
+		text_len = 0U;
+		return std::move(phrases);
+	}
+
+	const_iterator begin() const
+	{
+		return phrases.begin();
+	}
+
+	const_iterator end() const
+	{
+		return phrases.end();
+	}
+
+	const edge_t &operator[](size_t idx) const
+	{
+		return phrases[idx];
+	}
+
+	/** Number of phrases */
+	size_t size() const
+	{
+		return phrases.size();
+	}
+
+	bool empty() const
+	{
+		return phrases.empty();
+	}
+
+	/** Length of the parsed text */
+	size_t text_length() const
+	{
+		return text_len;
+	}
+};
+
+#endif
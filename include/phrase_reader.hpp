@@ -53,6 +53,27 @@ class phrase_reader : public i_phrase_reader {
 	unsigned int text_pos;
 	std::uint32_t next_literal;
 	std::vector<byte> data_buffer;
+	bool use_bmi2;
+
+	void next_phrase(std::uint32_t &dst, std::uint32_t &len)
+	{
+		if (next_literal-- > 0U) {
+			dec.decode(dst, len);
+		} else {
+			dst = 0U;
+			dec.decode(data_buffer.data(), len, next_literal);
+		}
+		text_pos += len;
+	}
+
+#ifdef DECODE_BMI2
+	/** next_phrase(), compiled for BMI1/BMI2 */
+	__attribute__((target("bmi,bmi2"), flatten))
+	void next_phrase_bmi2(std::uint32_t &dst, std::uint32_t &len)
+	{
+		next_phrase(dst, len);
+	}
+#endif
 public:
 
 	/**
@@ -64,20 +85,20 @@ public:
 	 */
 	phrase_reader(byte *data, size_t length)
 		: 	text_len(length), dec(data, text_len), text_pos(0U), 
-			next_literal(0U), data_buffer(enc::get_literal_len())
+			next_literal(0U), data_buffer(enc::get_literal_len()), use_bmi2(has_bmi2())
 	{
 
 	}
 
 	void next(std::uint32_t &dst, std::uint32_t &len)
 	{
-		if (next_literal-- > 0U) {
-			dec.decode(dst, len);
-		} else {
-			dst = 0U;
-			dec.decode(data_buffer.data(), len, next_literal);
+#ifdef DECODE_BMI2
+		if (use_bmi2) {
+			next_phrase_bmi2(dst, len);
+			return;
 		}
-		text_pos += len;
+#endif
+		next_phrase(dst, len);
 	}
 
 	bool end()
@@ -66,6 +66,12 @@ public:
 		return true;
 	}
 
+	/** See fsg_protocol::skip_next() */
+	inline bool skip_next()
+	{
+		return gen.skip_next();
+	}
+
 	std::vector<edge_t> &get_edges()
 	{
 		return max_edge;
@@ -19,6 +19,7 @@
 
 #include <graph_cache.hpp>
 #include <optimal_parser.hpp>
+#include <parallel_parser.hpp>
 #include <meter_printer.hpp>
 
 class invoker {
@@ -26,10 +27,12 @@ protected:
 	cost_model cm;
 	text_info ti;
 	size_t literal_window;
+	/** Buffers of the parses, if any */
+	parse_arena *arena;
 public:
 
-	invoker(cost_model cm, text_info ti, size_t literal_window) 
-		: cm(cm), ti(ti), literal_window(literal_window)
+	invoker(cost_model cm, text_info ti, size_t literal_window, parse_arena *arena = nullptr)
+		: cm(cm), ti(ti), literal_window(literal_window), arena(arena)
 	{
 
 	}
@@ -50,17 +53,28 @@ template <typename observer_t>
 class single_invoker : public invoker {
 public:
 
-	single_invoker(cost_model cm, text_info ti, size_t literal_window) 
-		: invoker(cm, ti, literal_window)
+	single_invoker(cost_model cm, text_info ti, size_t literal_window, parse_arena *arena = nullptr)
+		: invoker(cm, ti, literal_window, arena)
 	{
 
 	}
 
 	template <typename fsg_t>
-	std::vector<edge_t> invoke(fsg_t &&fsg, double *cost)
+	phrase_list invoke(fsg_t &&fsg, double *cost)
 	{
 		double sol_cost;
-		auto to_ret = parse(ti, std::forward<fsg_t>(fsg), literal_window, cm, &sol_cost, observer_t(ti.len));
+		auto to_ret = parse(ti, std::forward<fsg_t>(fsg), literal_window, cm, &sol_cost, observer_t(ti.len), arena);
+		if (cost != nullptr) {
+			*cost = sol_cost;
+		}
+		return to_ret;
+	}
+
+	template <typename decoder_t>
+	phrase_list invoke_parallel(const graph_cuts<decoder_t> &cuts, size_t threads, double *cost)
+	{
+		double sol_cost;
+		auto to_ret = parallel_parse(ti, cuts, threads, literal_window, cm, &sol_cost, observer_t(ti.len), arena);
 		if (cost != nullptr) {
 			*cost = sol_cost;
 		}
@@ -80,17 +94,28 @@ private:
 	cost_model w_cm;
 public:
 
-	double_invoker(cost_model cm, cost_model w_cm, text_info ti, size_t literal_window) 
-		: invoker(cm, ti, literal_window), w_cm(w_cm)
+	double_invoker(cost_model cm, cost_model w_cm, text_info ti, size_t literal_window, parse_arena *arena = nullptr)
+		: invoker(cm, ti, literal_window, arena), w_cm(w_cm)
 	{
 
 	}
 
 	template <typename fsg_t>
-	std::vector<edge_t> invoke(fsg_t &&fsg, double *cost)
+	phrase_list invoke(fsg_t &&fsg, double *cost)
 	{
 		double sol_cost;
-		auto to_ret = bi_optimal_parse(ti, std::forward<fsg_t>(fsg), literal_window, cm, w_cm, &sol_cost, observer_t(ti.len));
+		auto to_ret = bi_optimal_parse(ti, std::forward<fsg_t>(fsg), literal_window, cm, w_cm, &sol_cost, observer_t(ti.len), arena);
+		if (cost != nullptr) {
+			*cost = sol_cost;
+		}
+		return to_ret;
+	}
+
+	template <typename decoder_t>
+	phrase_list invoke_parallel(const graph_cuts<decoder_t> &cuts, size_t threads, double *cost)
+	{
+		double sol_cost;
+		auto to_ret = parallel_bi_optimal_parse(ti, cuts, threads, literal_window, cm, w_cm, &sol_cost, observer_t(ti.len), arena);
 		if (cost != nullptr) {
 			*cost = sol_cost;
 		}
@@ -105,32 +130,48 @@ public:
 };
 
 // Assumption: we always pass compatible cost_models
-template <typename observer_t = empty_observer, typename inner_fact_t = gen_ffsg_fact>
+// codec_t picks the encoding of the cached graph (see graph_cache.hpp)
+template <typename observer_t = empty_observer, typename inner_fact_t = gen_ffsg_fact, typename codec_t = unary_codec>
 class solution_getter {
 private:
+	typedef typename codec_t::encoder_t encoder_t;
+	typedef typename codec_t::decoder_t decoder_t;
+
 	text_info ti;
 	cached_graph cg;
+	/** Suffix arrays of the text, shared with whoever asks for them (see suffix_arrays()) */
 	sa_cacher sc;
 	size_t literal_window;
+	size_t threads;
+	/** Buffers of the parses, owned by the user of the solution getter (see use_arena()) */
+	parse_arena *arena;
+	/** Segments of the cached graph, computed again for cost models they do not fit */
+	std::shared_ptr<graph_cuts<decoder_t>> cuts;
 
 	template <typename Invoker_>
-	std::vector<edge_t> invoke_fast(Invoker_ invoker, double *cost)
+	phrase_list invoke_fast(Invoker_ invoker, double *cost)
 	{
 		auto cm = invoker.get_cm();
 		if (cg.empty()) {
 			return full(cm);
 		}
-		auto cache_fsg = cached_fsg_fact<>(ti, sc, cg).instantiate(cm);
+		if (threads > 1U) {
+			if (!cuts || !cuts->fits(cm)) {
+				cuts = std::make_shared<graph_cuts<decoder_t>>(cg, cm, ti.len, threads);
+			}
+			return invoker.invoke_parallel(*cuts, threads, cost);
+		}
+		auto cache_fsg = cached_fsg_fact<decoder_t>(ti, sc, cg).instantiate(cm);
 		return invoker.invoke(*cache_fsg.get(), cost);
 	}	
 
 	template <typename Invoker_>
-	std::vector<edge_t> invoke_full(Invoker_ invoker, double *cost)
+	phrase_list invoke_full(Invoker_ invoker, double *cost)
 	{
 		auto cm = invoker.get_cm();
 		if (cg.empty()) {
 			// Use caching
-			auto caching_fsg = caching_fsg_fact<>(ti, sc, &cg).instantiate(cm);
+			auto caching_fsg = caching_fsg_fact<gen_ffsg_fact, encoder_t>(ti, sc, &cg).instantiate(cm);
 			return invoker.invoke(*caching_fsg.get(), cost);
 		} else {
 			// Use regular generation
@@ -141,34 +182,44 @@ private:
 
 public:
 
-	solution_getter()
+	solution_getter() : threads(1U), arena(nullptr)
 	{
 
 	}
 
-	solution_getter(text_info ti, size_t literal_window) : ti(ti), literal_window(literal_window)
+	/**
+	 * @param threads
+	 *		Number of threads used to parse the cached graph (1 = sequential parsing)
+	 * @param spill_dir
+	 *		If not empty, the cached graph is kept in a temporary file in this directory
+	 */
+	solution_getter(text_info ti, size_t literal_window, size_t threads = 1U, std::string spill_dir = "")
+		: ti(ti), literal_window(literal_window), threads(threads), arena(nullptr)
 	{
+		if (!spill_dir.empty()) {
+			cg = cached_graph(spill_dir);
+		}
 
 	}
 
-	std::vector<edge_t> fast(cost_model cm, double *cost = nullptr)
+	phrase_list fast(cost_model cm, double *cost = nullptr)
 	{
-		return invoke_fast(single_invoker<observer_t>(cm, ti, literal_window), cost);
+		return invoke_fast(single_invoker<observer_t>(cm, ti, literal_window, arena), cost);
 	}
 
-	std::vector<edge_t> full(cost_model cm, double *cost = nullptr)
+	phrase_list full(cost_model cm, double *cost = nullptr)
 	{
-		return invoke_full(single_invoker<observer_t>(cm, ti, literal_window), cost);
+		return invoke_full(single_invoker<observer_t>(cm, ti, literal_window, arena), cost);
 	}
 
-	std::vector<edge_t> fast(cost_model cm, cost_model w_cm, double *cost = nullptr)
+	phrase_list fast(cost_model cm, cost_model w_cm, double *cost = nullptr)
 	{
-		return invoke_fast(double_invoker<observer_t>(cm, w_cm, ti, literal_window), cost);
+		return invoke_fast(double_invoker<observer_t>(cm, w_cm, ti, literal_window, arena), cost);
 	}
 
-	std::vector<edge_t> full(cost_model cm, cost_model w_cm, double *cost = nullptr)
+	phrase_list full(cost_model cm, cost_model w_cm, double *cost = nullptr)
 	{
-		return invoke_full(double_invoker<observer_t>(cm, w_cm, ti, literal_window), cost);
+		return invoke_full(double_invoker<observer_t>(cm, w_cm, ti, literal_window, arena), cost);
 	}
 
 	bool warm()
@@ -176,6 +227,21 @@ public:
 		return !cg.empty();
 	}
 
+	/**
+	 * Makes the following parses take their buffers from arena (nullptr to
+	 * stop). Parsings returned meanwhile can be given back to it.
+	 */
+	void use_arena(parse_arena *arena)
+	{
+		this->arena = arena;
+	}
+
+	/** Suffix arrays of the text, e.g. for a solution_integrator */
+	sa_getter &suffix_arrays()
+	{
+		return sc;
+	}
+
 };
 
 #endif
\ No newline at end of file
@@ -27,64 +27,62 @@
 
 class vector_in {
 private:
-	std::vector<edge_t> *sol;
+	const phrase_list *sol;
 	byte *text;
-	unsigned int pos;
+	/** Next phrase */
+	size_t idx;
 public:
-	vector_in(std::vector<edge_t> *v, byte *text)
-		: sol(v), text(text), pos(0)
+	vector_in(const phrase_list *v, byte *text)
+		: sol(v), text(text), idx(0)
 	{
 
 	}
 
 	std::tuple<unsigned int, unsigned int, byte*> next()
 	{
-		auto &edge = (*sol)[pos];
+		auto &edge = (*sol)[idx++];
 		auto data = text;
-		pos += edge.ell;
 		text += edge.ell;
 		return std::make_tuple(edge.d, edge.ell, data);
 	}
 
+	/** Phrases following the last one read up to the next literal (as write_parsing) */
 	unsigned int nextliteral()
 	{
-		for (auto pos_ = pos + 1; pos_ != sol->size(); ++pos_)
+		for (auto idx_ = idx; idx_ != sol->size(); ++idx_)
 		{
-			if ((*sol)[pos_].kind() == PLAIN) {
-				return pos_ - pos - 1;
+			if ((*sol)[idx_].kind() == PLAIN) {
+				return idx_ - idx;
 			}
 		}
-		return sol->size() - pos;
+		return sol->size() - idx + 1;
 	}
 };
 
 class vector_out {
 private:
-	std::vector<edge_t> *sol;
+	phrase_list *sol;
 	byte *text;
 	byte *start;
 	byte *end;
-	unsigned int pos;
 	cost_model cm;
 public:
-	vector_out(std::vector<edge_t> *v, byte *text, byte *end, cost_model cm)
-		: sol(v), text(text), start(text), end(end), pos(0), cm(cm)
+	vector_out(phrase_list *v, byte *text, byte *end, cost_model cm)
+		: sol(v), text(text), start(text), end(end), cm(cm)
 	{
 
 	}
 
 	void push_lit(unsigned int len, byte *data, std::uint32_t)
 	{
-		(*sol)[pos] = edge_t(len);
-		pos += len;
+		sol->push_back(edge_t(len));
 		text = std::copy(data, data + len, text);
 		assert(text <= end);
 	}
 
 	void push(unsigned int dst, unsigned int len)
 	{
-		(*sol)[pos] = edge_t(dst, len, cm.get_id(dst, len));
-		pos += len;
+		sol->push_back(edge_t(dst, len, cm.get_id(dst, len)));
 		assert(text - dst >= start);
 		assert(text + len <= end);
 		copy_fast(text, text - dst, len);
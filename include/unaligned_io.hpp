@@ -19,6 +19,8 @@
 
 #include <array>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <assert.h>
 #include <common.hpp>
@@ -107,6 +109,12 @@ public:
 		data += bytes;
 	}
 
+	/** Moves the writing head back by the given number of bytes */
+	void rewind(size_t bytes)
+	{
+		data -= bytes;
+	}
+
 	void skip_bits(unsigned int bits)
 	{
 		bit_offset += bits;
@@ -202,6 +210,110 @@ public:
 
 };
 
+/**
+ * Reads the stream of a writer through a 64-bit bit buffer ("lookahead and
+ * consume"): refill() tops the buffer up to at least min_lookahead bits with
+ * a single unaligned load and no branches, lookahead() exposes the buffer,
+ * consume() drops its lowest bits.
+ *
+ * A refill may load up to padding bytes past the last bit of the stream, so
+ * buffers must be padded accordingly, and the stream must be complete before
+ * reading it (assumes a little-endian target).
+ */
+class bit_reader {
+private:
+	/** First byte not yet loaded in the buffer: its bits start at bit count */
+	byte *next;
+	std::uint64_t buffer;
+	unsigned int count;
+
+public:
+	/** Bits available after a refill */
+	static const unsigned int min_lookahead = 56U;
+	/** Bytes that may be read past the end of the stream */
+	static const size_t padding = 16U;
+
+	bit_reader(byte *data) : next(data), buffer(0U), count(0U)
+	{
+
+	}
+
+	void refill()
+	{
+		std::uint64_t word;
+		std::memcpy(&word, next, sizeof(word));
+		buffer |= word << count;
+		next += (63U - count) >> 3U;
+		count |= min_lookahead;
+	}
+
+	/** Buffered bits: only the lowest min_lookahead are valid after a refill */
+	std::uint64_t lookahead() const
+	{
+		return buffer;
+	}
+
+	void consume(unsigned int bits)
+	{
+		assert(bits <= count);
+		buffer >>= bits;
+		count -= bits;
+	}
+
+	template <typename T>
+	void peek(T &t, unsigned int bits)
+	{
+		assert(bits <= min_lookahead);
+		refill();
+		t = buffer & ((std::uint64_t(1) << bits) - 1);
+	}
+
+	template <typename T>
+	void peek(T &t)
+	{
+		peek(t, sizeof(t) * 8);
+	}
+
+	template <typename T>
+	void read(T &t, unsigned int bits)
+	{
+		peek(t, bits);
+		consume(bits);
+	}
+
+	template <typename T>
+	void read(T &t)
+	{
+		read(t, sizeof(t) * 8);
+	}
+
+	void skip_bits(unsigned int bits)
+	{
+		refill();
+		consume(bits);
+	}
+
+	/** Moves forward by whole bytes, dropping the buffer */
+	void skip_bytes(unsigned int bytes)
+	{
+		auto bit_offset = offset();
+		next = reading_head() + bytes;
+		buffer = 0U;
+		count = 0U;
+		skip_bits(bit_offset);
+	}
+
+	byte *reading_head()
+	{
+		return next - ((count + 7U) >> 3U);
+	}
+
+	unsigned int offset()
+	{
+		return -count & 7U;
+	}
+};
+
 namespace literal {
 
 template <typename range_t, std::uint64_t start_>
@@ -251,9 +363,10 @@ public:
 template <typename range_t, std::uint64_t start_>
 class reader {
 public:
+	template <typename reader_t>
 	void read(
 		byte *dest, std::uint32_t &ret_length, std::uint32_t &next_literal,
-		unaligned_io::reader &reader
+		reader_t &reader
 	)
 	{
 		// Read next_literal and run length
@@ -309,9 +422,10 @@ public:
 
 class single_reader {
 public:
+	template <typename reader_t>
 	void read(
 		byte *dest, std::uint32_t &length, std::uint32_t &next_literal,
-		unaligned_io::reader &reader
+		reader_t &reader
 	)
 	{
 		// Read next_literal and run length
@@ -26,6 +26,7 @@
 
 #include <common.hpp>
 #include <io.hpp>
+#include <phrase_list.hpp>
 #include <cost_model.hpp>
 
 std::shared_ptr<std::vector<std::int32_t>> get_sa(byte *s, size_t len);
@@ -68,7 +69,7 @@ struct correctness_report {
 	}
 };
 
-correctness_report check_correctness(const std::vector<edge_t> &sol, byte *start);
+correctness_report check_correctness(const phrase_list &sol, byte *start);
 
 /****** SUFFIX ARRAY CACHER **********/
 class sa_getter {
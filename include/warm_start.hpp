@@ -0,0 +1,85 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __WARM_START_HPP
+#define __WARM_START_HPP
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+/** Bound, encoder and target of a warm_start_entry */
+typedef std::tuple<std::string, std::string, std::string> warm_start_key;
+
+/**
+ * What a bicriteria compression found: the λ of the optimal dual basis and
+ * of its two solutions. A later compression with the same bound, encoder
+ * and target (of a similar text) solves for these λs first, and usually
+ * starts from a basis close to its optimal one.
+ */
+struct warm_start_entry {
+	std::string bound;
+	std::string encoder;
+	std::string target;
+	double lambda;
+	/** λ of the solutions of the basis (negative: cost- or weight-optimal) */
+	double left_lambda;
+	double right_lambda;
+	/** Space and time of the solutions of the basis, for reference */
+	double left_space;
+	double left_time;
+	double right_space;
+	double right_time;
+
+	warm_start_entry()
+		: lambda(0), left_lambda(-1), right_lambda(-1),
+		  left_space(0), left_time(0), right_space(0), right_time(0)
+	{
+
+	}
+
+	warm_start_key key() const
+	{
+		return warm_start_key(bound, encoder, target);
+	}
+};
+
+/**
+ * A sidecar file of warm_start_entry, one per line with tab-separated
+ * fields; lines starting with # are comments. A missing file is empty, and
+ * malformed lines are skipped (and dropped when the file is saved again).
+ */
+class warm_start_file {
+private:
+	std::string path;
+	std::vector<warm_start_entry> entries;
+
+public:
+	/** Loads the file at path, if any */
+	explicit warm_start_file(std::string path);
+
+	/** Entry of a bound, encoder and target, if any */
+	bool find(const std::string &bound, const std::string &encoder, const std::string &target, warm_start_entry *entry) const;
+
+	/**
+	 * Adds or replaces the entry of its bound, encoder and target, and saves
+	 * the file: written aside and renamed over it, so that it is either the
+	 * old or the new one. Throws std::runtime_error if it cannot be written.
+	 */
+	void store(const warm_start_entry &entry);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __WAVELET_MATRIX_HPP
+#define __WAVELET_MATRIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * A wavelet matrix over a sequence of integers below 2^32, taking
+ * about log(max value) bits per entry. Besides access(), it answers
+ * range successor/predecessor queries: the smallest (greatest) value
+ * not below (below) a threshold among the entries of a range of the
+ * sequence, in O(log(max value)) rank operations.
+ */
+class wavelet_matrix {
+private:
+	/** A bit vector with rank support (one counter every 512 bits) */
+	struct level {
+		std::vector<std::uint64_t> bits;
+		std::vector<std::uint32_t> ranks;
+		/** Zeros in the level: entries whose bit is 1 are placed after them */
+		size_t zeros;
+
+		size_t rank0(size_t i) const;
+
+		size_t rank1(size_t i) const
+		{
+			return i - rank0(i);
+		}
+
+		bool get(size_t i) const
+		{
+			return (bits[i >> 6] >> (i & 63U)) & 1U;
+		}
+	};
+
+	size_t n;
+	unsigned int width;
+	std::vector<level> levels;
+
+	/** Smallest value in [a, b) at level l, whose higher bits are prefix */
+	std::uint64_t min_value(unsigned int l, size_t a, size_t b, std::uint64_t prefix) const;
+	std::uint64_t max_value(unsigned int l, size_t a, size_t b, std::uint64_t prefix) const;
+	std::uint64_t next_value(unsigned int l, size_t a, size_t b, std::uint64_t x, std::uint64_t prefix) const;
+	std::uint64_t prev_value(unsigned int l, size_t a, size_t b, std::uint64_t x, std::uint64_t prefix) const;
+
+public:
+	/** Returned by the queries when no value qualifies */
+	static const std::uint64_t npos = std::numeric_limits<std::uint64_t>::max();
+
+	wavelet_matrix() : n(0), width(0)
+	{
+
+	}
+
+	explicit wavelet_matrix(const std::vector<std::uint32_t> &values);
+
+	size_t size() const
+	{
+		return n;
+	}
+
+	std::uint32_t access(size_t i) const;
+
+	/** Smallest value >= x in [a, b), or npos */
+	std::uint64_t next_value(size_t a, size_t b, std::uint64_t x) const;
+
+	/** Greatest value < x in [a, b), or npos */
+	std::uint64_t prev_value(size_t a, size_t b, std::uint64_t x) const;
+};
+
+#endif
@@ -18,28 +18,63 @@
 #define WRITE_PARSING_HPP
 
 #include <assert.h>
+#include <algorithm>
+#include <cstdint>
 #include <edges.hpp>
 #include <base_fsg.hpp>
+#include <checksum.hpp>
 #include <encoders.hpp>
 #include <format.hpp>
+#include <phrase_list.hpp>
 
-template <typename ret_t = size_t, typename T>
-ret_t parsing_length(const T begin, const T end, const cost_model &cm)
+template <typename ret_t = size_t>
+ret_t parsing_length(const phrase_list &sol, const cost_model &cm)
 {
 	ret_t size = ret_t();
-	auto it = begin;
-	auto vend = std::prev(end, 1);
-	auto length = 0U;
-	while (it < vend) {
-		const edge_t &edge = *it;
-		size += cm.edge_cost(edge);
-		length += edge.ell;
-		std::advance(it, edge.ell);
+	// Recent distances, for the models with cheaper repeated copies
+	rep_distances reps;
+	for (const edge_t &edge : sol) {
+		size += cm.edge_cost(edge, reps);
+		if (edge.kind() == REGULAR) {
+			reps.push(edge.d);
+		}
 	}
-	size += length * cm.cost_per_char();
+	size += sol.text_length() * cm.cost_per_char();
 	return size;
 }
 
+/**
+ * Bytes to be reserved past the end of the text to decompress in place a
+ * parsing of comp_len bytes, laid at the end of the buffer: the output of
+ * every phrase (plus the slack of the copies) must end before the first byte
+ * of the parsing not read yet. Phrase offsets come from the static cost
+ * model, exact for the single-stream encoders; for the others the parsing
+ * is read from anywhere, hence it must not overlap the text.
+ */
+template <typename enc_>
+size_t in_place_margin(const phrase_list &sol, size_t comp_len)
+{
+	typedef typename enc_::encoder enc_t;
+	if (!single_stream<enc_t>::value) {
+		return comp_len + in_place_slack;
+	}
+	auto cm = enc_t::get_cm();
+	rep_distances reps;
+	// Bits read and bytes written after every phrase
+	double read = 0.0;
+	std::int64_t written = 0, overtake = in_place_slack;
+	for (const edge_t &edge : sol) {
+		read += cm.edge_cost(edge, reps) + edge.ell * cm.cost_per_char();
+		if (edge.kind() == REGULAR) {
+			reps.push(edge.d);
+		}
+		written += edge.ell;
+		auto read_bytes = static_cast<std::int64_t>(read) / 8;
+		overtake = std::max<std::int64_t>(overtake, written + in_place_slack - read_bytes);
+	}
+	return std::max<std::int64_t>(overtake + comp_len - written, in_place_slack);
+}
+
 class encoder_overhead_getter {
 private:
 	size_t p_len;
@@ -67,16 +102,14 @@ public:
 /**
  * Gets the total parsing space (parsing + encoder overhead)
  * \param 	enc_name 	Encoder name
- * \param 	begin		Parsing iterator to first element
- * \param 	end 		Parsing iterator to one-past-end
+ * \param 	sol			The parsing
  * \return	Total parsing space, IN BYTES
  */
-template <typename T>
-size_t parsing_space(std::string enc_name, const T begin, const T end)
+inline size_t parsing_space(std::string enc_name, const phrase_list &sol)
 {
 	encoders_ encoders_container;
 	auto cm = encoders_container.get_cm(enc_name);
-	auto p_len = parsing_length(begin, end, cm);
+	auto p_len = parsing_length(sol, cm);
 	encoder_overhead_getter getter(p_len);
 	encoders_().call(enc_name, getter);
 	return getter.get_len();
@@ -91,7 +124,7 @@ public:
 	 * @return
 	 *		The parsing size
 	 */
-	virtual size_t write(std::string file_name, text_info ti, std::vector<edge_t> &solution) = 0;
+	virtual size_t write(std::string file_name, text_info ti, const phrase_list &solution) = 0;
 	/**
 	 * @brief Write a parsing, trusting solution cost as parsing length
 	 * @param file_name
@@ -99,7 +132,7 @@ public:
 	 * @return
 	 *		The parsing size
 	 */
-	virtual size_t write(std::string file_name, text_info ti, std::vector<edge_t> &solution, size_t size) = 0;
+	virtual size_t write(std::string file_name, text_info ti, const phrase_list &solution, size_t size) = 0;
 
 	virtual ~base_writer()
 	{
@@ -115,61 +148,61 @@ struct compressed_file {
 
 /**
  * Gets the compressed rep. of the parsing.
- * \param 	sol 			Parsing, in "edge" format
+ * \param 	sol 			Parsing
  * \param 	parsing_length 	Length of compressed parsing, IN BYTES
  * \param 	ti 				Uncompressed text
  * \param 	output 			Start of compressed rep. (memory must be allocated and zeroed)
+ * \return	Bytes of output taken by the parsing (at most parsing_length)
  */
 template <typename enc_>
-void write_parsing(const std::vector<edge_t> &sol, size_t parsing_length, text_info ti, byte *output)
+size_t write_parsing(const phrase_list &sol, size_t parsing_length, text_info ti, byte *output)
 {
 	typedef typename enc_::encoder enc_t;
 	// (2): instantiate the encoder
 	enc_t enc(output, parsing_length);
 
 	// (3): encode each phrase and return it
-	uint32_t j, nextliteral = 0;
+	uint32_t nextliteral = 0;
 	byte *text = ti.text.get();
-	auto length = ti.len;
+	assert(sol.text_length() == ti.len);
 	// Encode phrases
 	// Bit 0 + single char 1 <dist, length>
-	for (uint32_t i = 0; i < length;) {
-		auto &edge = sol[i];
+	size_t i = 0;
+	for (auto it = sol.begin(); it != sol.end(); ++it) {
+		auto &edge = *it;
 		assert(!edge.invalid());
 		if (edge.kind() == PLAIN) {
 			// # of phrases up to next literal
-			nextliteral = 0;
-			for (j = i + edge.ell; j < length; nextliteral++) {
-				if (sol[j].kind() == PLAIN){
-					break;
-				} else {
-					j += sol[j].ell;
-				}
+			auto next = std::next(it);
+			while (next != sol.end() && next->kind() != PLAIN) {
+				++next;
 			}
-			if (j >= length) {
+			nextliteral = std::distance(it, next) - 1;
+			if (next == sol.end()) {
 				nextliteral++;
 			}
 			enc.encode(text + i, edge.ell, nextliteral);
-			i += edge.ell;
 		} else {
 			assert(edge.kind() == REGULAR);
-			unsigned int d = sol[i].d, ell = sol[i].ell;
-			enc.encode(d, ell);
-			i += ell;
+			enc.encode(edge.d, edge.ell);
 		}
-	}	
+		i += edge.ell;
+	}
+	return written_len(enc, parsing_length);
 }
 
 class generic_parsing_writer {
 private:
-	const std::vector<edge_t> &sol;
+	const phrase_list &sol;
 	size_t parsing_length;
 	text_info ti;
 	byte *output;
 public:
+	size_t written;
+
 	generic_parsing_writer(
-		const std::vector<edge_t> &sol, size_t parsing_length, text_info ti, byte *output
-	) : sol(sol), parsing_length(parsing_length), ti(ti), output(output)
+		const phrase_list &sol, size_t parsing_length, text_info ti, byte *output
+	) : sol(sol), parsing_length(parsing_length), ti(ti), output(output), written(0)
 	{
 
 	}
@@ -177,14 +210,20 @@ public:
 	template <typename enc_>
 	void run()
 	{
-		write_parsing<enc_>(sol, parsing_length, ti, output);
+		written = write_parsing<enc_>(sol, parsing_length, ti, output);
 	}
 };
 
-void write_parsing(
-	std::string enc_name, const std::vector<edge_t> &sol, size_t parsing_length, text_info ti, byte *output
+size_t write_parsing(
+	std::string enc_name, const phrase_list &sol, size_t parsing_length, text_info ti, byte *output
 );
 
+/** See in_place_margin above */
+size_t in_place_margin(std::string enc_name, const phrase_list &sol, size_t comp_len);
+
+/** Appends the checksums of the text to a compressed file, and stores their block size in the header */
+void add_checksums(compressed_file &file, const block_checksums &checksums);
+
 /**
  * Gets the compressed rep. of the parsing.
  * Template parameters:
@@ -200,12 +239,14 @@ void write_parsing(
  *	- V3:				Compressed length (excludes encoder name etc.)
  */
 template <typename enc_>
-compressed_file write_parsing(const std::vector<edge_t> &sol, size_t parsing_length, text_info ti)
+compressed_file write_parsing(const phrase_list &sol, size_t parsing_length, text_info ti)
 {
 	typedef typename enc_::encoder enc_t;
-	// (1): Pack the header
+	// (1): Pack the header. The length may come from a cost model tuned on the
+	// text, which is not an upper bound: the static one is.
+	parsing_length = std::max(parsing_length, ::parsing_length<size_t>(sol, enc_t::get_cm()));
 	size_t byte_parsing_length = enc_t::data_len(parsing_length);
-	std::uint32_t length = sol.size() - 1;
+	std::uint32_t length = sol.text_length();
 
 	pack_info p_info = pack(enc_::name(), length, byte_parsing_length);
 	std::unique_ptr<byte[]> data_holder = std::move(p_info.parsing);
@@ -214,10 +255,11 @@ compressed_file write_parsing(const std::vector<edge_t> &sol, size_t parsing_len
 	byte *data = std::get<2>(unpack(data_holder.get()));
 
 	// (2): write the parsing
-	write_parsing<enc_>(sol, byte_parsing_length, ti, data);
+	auto written = write_parsing<enc_>(sol, byte_parsing_length, ti, data);
+	set_in_place_margin(data_holder.get(), in_place_margin<enc_>(sol, written));
 
 	// (3): return it
-	return { std::move(data_holder), data_len, byte_parsing_length };
+	return { std::move(data_holder), data_len - (byte_parsing_length - written), written };
 }
 
 template <typename enc_>
@@ -232,12 +274,12 @@ public:
 
 	}
 
-	size_t write(std::string filename, text_info ti, std::vector<edge_t> &sol)
+	size_t write(std::string filename, text_info ti, const phrase_list &sol)
 	{
-		return write(filename, ti, sol, parsing_length(sol.begin(), sol.end(), enc_t::get_cm()));
+		return write(filename, ti, sol, parsing_length(sol, enc_t::get_cm()));
 	}
 
-	size_t write(std::string filename, text_info ti, std::vector<edge_t> &sol, size_t parsing_length)
+	size_t write(std::string filename, text_info ti, const phrase_list &sol, size_t parsing_length)
 	{
 		// (1) get the parsing
 		auto comp_file = write_parsing<enc_>(sol, parsing_length, ti);
@@ -252,7 +294,7 @@ public:
 		return clen;
 	}
 
-	size_t write_noconv(std::string file_name, text_info ti, std::vector<edge_t> &solution, size_t size)
+	size_t write_noconv(std::string file_name, text_info ti, const phrase_list &solution, size_t size)
 	{
 		throw std::logic_error("Write_noconv not implemented yet");
 	}
@@ -274,8 +316,8 @@ public:
 	}
 };
 
-void write_parsing(std::vector<edge_t> &sol, text_info ti, std::string file_name, std::string encoder_name);
-compressed_file write_parsing(const std::vector<edge_t> &sol, text_info ti, std::string encoder_name);
-compressed_file write_parsing(const std::vector<edge_t> &sol, text_info ti, std::string encoder_name, cost_model cm);
+void write_parsing(const phrase_list &sol, text_info ti, std::string file_name, std::string encoder_name);
+compressed_file write_parsing(const phrase_list &sol, text_info ti, std::string encoder_name);
+compressed_file write_parsing(const phrase_list &sol, text_info ti, std::string encoder_name, cost_model cm);
 
 #endif // WRITE_PARSING_HPP
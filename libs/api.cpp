@@ -24,6 +24,8 @@
 #include <meter_printer.hpp>
 #include <generators.hpp>
 #include <optimal_parser.hpp>
+#include <solution_getter.hpp>
+#include <bicriteria_compressor.hpp>
 
 class allocate_parsing {
 protected:
@@ -46,6 +48,18 @@ public:
 		return std::move(data_stored);
 	}
 
+	/** Stores the in-place margin of the parsing, if there is a header */
+	virtual void set_margin(size_t)
+	{
+
+	}
+
+	/** Drops the last unused bytes of the stored parsing */
+	void shrink(size_t unused)
+	{
+		stored_size -= unused;
+	}
+
 	virtual ~allocate_parsing()
 	{
 
@@ -86,6 +100,11 @@ public:
 		stored_size = info.data_len;
 		return to_ret;
 	}
+
+	void set_margin(size_t margin)
+	{
+		set_in_place_margin(data_stored.get(), margin);
+	}
 };
 
 class empty_delete {
@@ -119,7 +138,7 @@ public:
 	{
 		// Get the cost_model
 		encoders_ enc_container;
-		auto cm = enc_container.get_cm(encoder_name);
+		auto cm = enc_container.get_cm(encoder_name, uncompressed, uncomp_len);
 		auto lit_win = enc_container.get_literal_len(encoder_name);
 
 		// Get the text_info.
@@ -138,13 +157,53 @@ public:
 		auto solution = parse(ti, *(fsg.get()), lit_win, cm, &cost, empty_observer());
 
 		// Get parsing length, in bytes, plus encoder overhead
-		auto length = parsing_space(encoder_name, ITERS(solution));
+		auto length = parsing_space(encoder_name, solution);
 
 		// Allocate space
 		byte *output = allocator->alloc(length, uncomp_len);
 
 		// Compress the parsing and put the content in there
-		write_parsing(encoder_name, solution, length, ti, output);
+		auto written = write_parsing(encoder_name, solution, length, ti, output);
+		allocator->shrink(length - written);
+		allocator->set_margin(in_place_margin(encoder_name, solution, written));
+	}
+};
+
+class bicriteria_caller {
+private:
+	byte *uncompressed;
+	size_t uncomp_len;
+	cost_model time_cm;
+	std::shared_ptr<bound> b;
+	unsigned int threads;
+public:
+	compressed_file result;
+	size_t space;
+	double time;
+
+	bicriteria_caller(
+		byte *uncompressed, size_t uncomp_len,
+		cost_model time_cm, std::shared_ptr<bound> b, unsigned int threads
+	) : uncompressed(uncompressed), uncomp_len(uncomp_len), time_cm(time_cm), b(b), threads(threads), space(0), time(0)
+	{
+
+	}
+
+	template <typename enc_t>
+	void run()
+	{
+		auto space_cm = encoders_().get_cm(enc_t::name(), uncompressed, uncomp_len);
+		auto lit_win = enc_t::encoder::get_literal_len();
+
+		// Don't take ownership of the text (see bitoptimal_caller)
+		std::shared_ptr<byte> wrapper_text(uncompressed, empty_delete());
+		text_info ti(wrapper_text, uncomp_len);
+
+		typedef solution_getter<empty_observer, gen_ffsg_fact, unary_codec> sol_getter_t;
+		sol_getter_t sg(ti, lit_win, std::max(1U, threads));
+		bicriteria_compressor<enc_t, sol_getter_t> compressor(ti, sg, space_cm, time_cm);
+		compressor.set_log(nullptr);
+		result = compressor.run(b, false, &space, &time);
 	}
 };
 
@@ -162,6 +221,17 @@ std::unique_ptr<byte[]> bczip::decompress(byte *compressed, size_t *decompressed
 	return std::move(o.rep);
 }
 
+size_t bczip::decompress_prefix(byte *compressed, byte *output, size_t max_bytes)
+{
+	std::string enc_name;
+	size_t orig_size;
+	byte *parsing;
+	std::tie(enc_name, orig_size, parsing) = unpack(compressed);
+	auto decompressor = encoders_().instantiate<base_decompress, dec_fact<fast_copy>>(enc_name, dec_fact<fast_copy>());
+	decompressor->run_prefix(parsing, output, orig_size, max_bytes);
+	return std::min(max_bytes, orig_size);
+}
+
 namespace bczip {
 namespace impl {
 std::unique_ptr<byte[]> compress(
@@ -197,6 +267,34 @@ bczip::compress(const char *encoder_name, byte *uncompressed, size_t length, siz
 	return bczip::impl::compress(encoder_name, uncompressed, length, compressed_length, &allocate);
 }
 
+std::unique_ptr<byte[]>
+bczip::compress_bounded(
+	const char *encoder_name, const cost_model &time_model, compression_bound bound_,
+	byte *uncompressed, size_t length, size_t *compressed_length,
+	size_t *space, double *time, unsigned int threads
+)
+{
+	auto type = bound_.kind == TIME_BOUND ? TIME : SPACE;
+	std::shared_ptr<bound> b;
+	if (bound_.relative) {
+		b = std::make_shared<relative_bound>(type, bound_.value);
+	} else {
+		b = std::make_shared<fixed_bound>(type, bound_.value);
+	}
+	bicriteria_caller caller(uncompressed, length, time_model, b, threads);
+	encoders_().call(encoder_name, caller);
+	if (compressed_length != nullptr) {
+		*compressed_length = caller.result.total_size;
+	}
+	if (space != nullptr) {
+		*space = caller.space;
+	}
+	if (time != nullptr) {
+		*time = caller.time;
+	}
+	return std::move(caller.result.data);
+}
+
 byte *bczip::extract_header(byte *parsing, char **encoder_name, std::uint32_t *file_size)
 {
 	byte *to_ret;
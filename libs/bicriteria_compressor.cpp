@@ -0,0 +1,119 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <bicriteria_compressor.hpp>
+
+#include <cmath>
+#include <ratio>
+#include <sstream>
+#include <stdexcept>
+
+std::string prec_print(unsigned int num, unsigned int den, unsigned int prec)
+{
+	std::stringstream ss;
+	if (num % den == 0) {
+		ss << num / den;
+	} else {
+		ss.precision(prec);
+		ss << std::fixed << 1.0 * num / den;
+	}
+	return ss.str();
+}
+
+std::ostream &operator<<(std::ostream &stream, const gen_info_t &gen)
+{
+	std::string s1, s2;
+	std::tie(s1, s2) = gen;
+	char hex_1[42], hex_2[42];
+	std::fill(hex_1, hex_1 + 42, '\0');
+	std::fill(hex_2, hex_2 + 42, '\0');
+	const unsigned char *ptr_1 = reinterpret_cast<const unsigned char *>(s1.c_str());
+	const unsigned char *ptr_2 = reinterpret_cast<const unsigned char *>(s2.c_str());
+
+	if (!s1.empty()) {
+		sha1::toHexString(ptr_1, hex_1);		
+	}
+	if (!s2.empty()) {
+		sha1::toHexString(ptr_2, hex_2);		
+	}
+	stream << "(" << hex_1;
+	if (!s2.empty()) {
+		stream << "," << hex_2;
+	}
+	stream << ")";
+
+	return stream;
+}
+
+void imbue_grouping(std::ostream &stream)
+{
+	try {
+		stream.imbue(std::locale("en_US.UTF-8")); // Leaks!
+	} catch (std::runtime_error &) {
+		// Not installed: numbers are printed without separators
+	}
+}
+
+std::ostream& operator<< (std::ostream& stream, const solution_info &si)
+{
+
+	// stream.imbue(std::locale(""));
+	imbue_grouping(stream);
+	stream.precision(2);
+
+	auto space_kb = si.get_space() / (8 * kilo_num);
+	std::chrono::duration<double, std::nano> time_nano(si.get_time());
+	auto time_msecs = std::chrono::duration_cast<std::chrono::milliseconds>(time_nano).count();
+	fmt::print(stream, "S = {0:.0f} ({1}KB), T = {2:.8f} ({3}ms)", si.get_space(), space_kb, si.get_time(), time_msecs);
+	// stream << std::fixed << "S = " << space_kb << "KB, T = " << time_msecs << "msecs";// << ", ID = " << si.get_gen_info();
+	return stream;
+}
+
+std::ostream &operator<<(std::ostream &stream, const dual_basis &basis)
+{
+	solution_info left, right;
+	std::tie(left, right) = basis.get_basis();
+	fmt::print(stream, "Left = {}\nRight = {}", left, right);
+	return stream;
+}
+
+std::chrono::milliseconds parse_duration(const std::string &param)
+{
+	size_t unit_pos;
+	double value;
+	try {
+		value = std::stod(param, &unit_pos);
+	} catch (std::logic_error &) {
+		throw std::runtime_error(join_s("Invalid duration: ", param));
+	}
+	auto unit = param.substr(unit_pos);
+	double millis;
+	if (unit == "ms") {
+		millis = value;
+	} else if (unit.empty() || unit == "s") {
+		millis = value * std::milli::den;
+	} else if (unit == "m") {
+		millis = value * 60 * std::milli::den;
+	} else if (unit == "h") {
+		millis = value * 3600 * std::milli::den;
+	} else {
+		throw std::runtime_error(join_s("Invalid duration unit: ", unit));
+	}
+	if (!(millis > 0)) {
+		throw std::runtime_error(join_s("Duration must be positive: ", param));
+	}
+	return std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(std::ceil(millis)));
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <checksum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+/** Reflected Castagnoli polynomial */
+const std::uint32_t polynomial = 0x82F63B78U;
+
+std::array<std::uint32_t, 256> make_table()
+{
+	std::array<std::uint32_t, 256> table;
+	for (std::uint32_t i = 0; i < 256; i++) {
+		std::uint32_t crc = i;
+		for (unsigned int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (polynomial & (0U - (crc & 1U)));
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+/** CRC32C update of the state crc with data[0, len), a byte at a time */
+std::uint32_t update_table(std::uint32_t crc, const byte *data, size_t len)
+{
+	static const auto table = make_table();
+	for (size_t i = 0; i < len; i++) {
+		crc = table[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+std::uint64_t load(const byte *data)
+{
+	std::uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+#ifdef CRC32C_SSE42
+__attribute__((target("sse4.2")))
+std::uint32_t update_sse42(std::uint32_t crc, const byte *data, size_t len)
+{
+	std::uint64_t state = crc;
+	for (; len >= 8; data += 8, len -= 8) {
+		state = _mm_crc32_u64(state, load(data));
+	}
+	crc = state;
+	for (; len > 0; --len) {
+		crc = _mm_crc32_u8(crc, *data++);
+	}
+	return crc;
+}
+
+/**
+ * Three blocks of len bytes at once: crc32 has a latency of three cycles
+ * and a throughput of one, so that independent streams keep it busy
+ */
+__attribute__((target("sse4.2")))
+void update_sse42_x3(std::uint32_t *crcs, const byte *data, size_t len)
+{
+	std::uint64_t a = crcs[0], b = crcs[1], c = crcs[2];
+	const byte *d_a = data, *d_b = data + len, *d_c = data + 2 * len;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		a = _mm_crc32_u64(a, load(d_a + i));
+		b = _mm_crc32_u64(b, load(d_b + i));
+		c = _mm_crc32_u64(c, load(d_c + i));
+	}
+	crcs[0] = update_sse42(a, d_a + i, len - i);
+	crcs[1] = update_sse42(b, d_b + i, len - i);
+	crcs[2] = update_sse42(c, d_c + i, len - i);
+}
+#endif
+
+bool detect_sse42()
+{
+#ifdef CRC32C_SSE42
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+#else
+	return false;
+#endif
+}
+
+bool has_sse42()
+{
+	static const bool available = detect_sse42();
+	return available;
+}
+
+std::uint32_t update(std::uint32_t crc, const byte *data, size_t len)
+{
+#ifdef CRC32C_SSE42
+	if (has_sse42()) {
+		return update_sse42(crc, data, len);
+	}
+#endif
+	return update_table(crc, data, len);
+}
+
+}
+
+std::uint32_t crc32c(const byte *data, size_t len)
+{
+	return ~update(~0U, data, len);
+}
+
+block_checksums checksum_blocks(const byte *text, size_t len, std::uint32_t block_size)
+{
+	if (block_size == 0U) {
+		throw std::logic_error("checksum_blocks: block size must be positive");
+	}
+	block_checksums to_ret;
+	to_ret.block_size = block_size;
+	to_ret.sums.resize(block_checksums::blocks(len, block_size));
+	size_t block = 0;
+#ifdef CRC32C_SSE42
+	if (has_sse42()) {
+		for (; (block + 3) * block_size <= len; block += 3) {
+			std::uint32_t *crcs = &to_ret.sums[block];
+			std::fill(crcs, crcs + 3, ~0U);
+			update_sse42_x3(crcs, text + block * block_size, block_size);
+			std::transform(crcs, crcs + 3, crcs, [](std::uint32_t crc) { return ~crc; });
+		}
+	}
+#endif
+	for (; block < to_ret.sums.size(); block++) {
+		auto start = block * block_size;
+		to_ret.sums[block] = crc32c(text + start, std::min<size_t>(block_size, len - start));
+	}
+	return to_ret;
+}
+
+size_t first_mismatch(const block_checksums &checksums, const byte *text, size_t len)
+{
+	auto actual = checksum_blocks(text, len, checksums.block_size);
+	if (actual.sums.size() != checksums.sums.size()) {
+		return 0U;
+	}
+	return std::mismatch(actual.sums.begin(), actual.sums.end(), checksums.sums.begin()).first - actual.sums.begin();
+}
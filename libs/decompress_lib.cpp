@@ -17,13 +17,86 @@
 #include <decompress.hpp>
 #include <format.hpp>
 
-dec_output decompress_full(byte *data)
+#include <algorithm>
+
+namespace {
+
+bool detect_bmi2()
+{
+#ifdef DECODE_BMI2
+	// May run before main: CPU detection must be initialized by hand
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+#else
+	return false;
+#endif
+}
+
+}
+
+bool has_bmi2()
+{
+	static const bool available = detect_bmi2();
+	return available;
+}
+
+dec_output decompress_full(byte *data, bool prefetch)
 {
 	std::string enc_name;
 	size_t orig_size;
 	std::tie(enc_name, orig_size, data) = unpack(data);
 	char *enc_ptr = const_cast<char*>(enc_name.data());
 	std::unique_ptr<byte[]> uncompressed = std::unique_ptr<byte[]>(new byte[orig_size + 8]);
-	std::uint64_t nanosecs = decompress_raw(enc_ptr, data, uncompressed.get(), orig_size);
-	return {std::move(uncompressed), enc_name, orig_size, nanosecs};
-}
\ No newline at end of file
+	std::uint64_t nanosecs = prefetch
+		? decompress_raw<fast_copy, prefetch_lookahead>(enc_ptr, data, uncompressed.get(), orig_size)
+		: decompress_raw(enc_ptr, data, uncompressed.get(), orig_size);
+	// Where the checksums start is unknown without the file size: none are read
+	return {std::move(uncompressed), enc_name, orig_size, nanosecs, block_checksums()};
+}
+
+dec_output decompress_in_place(std::istream &in, size_t file_size, bool prefetch)
+{
+	// The longest header: the format prefix, an encoder name of 20 bytes, then three fields
+	const size_t max_header = format_prefix + 20 + 3 * sizeof(uncomp_size_t);
+	byte header[max_header + 1] = {};
+	auto begin = in.tellg();
+	in.read(reinterpret_cast<char*>(header), std::min(file_size, max_header));
+	std::string enc_name;
+	size_t orig_size;
+	byte *start;
+	std::tie(enc_name, orig_size, start) = unpack(header);
+	size_t header_size = start - header;
+	if (header_size > file_size) {
+		throw ioexception("Truncated header");
+	}
+	block_checksums checksums;
+	checksums.block_size = checksum_block(header);
+	checksums.sums.resize(block_checksums::blocks(orig_size, checksums.block_size));
+	size_t sums_len = checksums.sums.size() * sizeof(std::uint32_t);
+	if (header_size + sums_len > file_size) {
+		throw ioexception("Truncated checksums");
+	}
+	size_t comp_len = file_size - header_size - sums_len;
+	size_t margin = in_place_margin(header);
+	if (margin == 0U || orig_size + margin < comp_len) {
+		// Unknown margin: the parsing follows the text
+		margin = comp_len + in_place_slack;
+	}
+
+	size_t buffer_len = orig_size + margin;
+	std::unique_ptr<byte[]> buffer(new byte[buffer_len + unaligned_io::bit_reader::padding]);
+	byte *parsing = buffer.get() + buffer_len - comp_len;
+	std::fill(buffer.get() + buffer_len, buffer.get() + buffer_len + unaligned_io::bit_reader::padding, 0U);
+	in.clear();
+	in.seekg(begin + static_cast<std::streamoff>(header_size));
+	in.read(reinterpret_cast<char*>(parsing), comp_len);
+	in.read(reinterpret_cast<char*>(checksums.sums.data()), sums_len);
+	if (in.bad() || in.fail()) {
+		throw ioexception("Failed to read file");
+	}
+
+	std::uint64_t nanosecs = prefetch
+		? decompress_raw<fast_copy, prefetch_lookahead>(enc_name.c_str(), parsing, buffer.get(), orig_size)
+		: decompress_raw(enc_name.c_str(), parsing, buffer.get(), orig_size);
+	return {std::move(buffer), enc_name, orig_size, nanosecs, std::move(checksums)};
+}
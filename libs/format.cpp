@@ -15,6 +15,8 @@
 */
 
 #include <cstring>
+#include <iterator>
+#include <stdexcept>
 
 #include <format.hpp>
 #include <string>
@@ -28,28 +30,74 @@ uncomp_size_t extract_size(byte *comp, byte **new_ptr)
 	return to_ret;
 }
 
+namespace {
+
+/** The uncompressed length, then (if versioned) the in-place margin and the checksum block size */
+uncomp_size_t *header_fields(byte *data)
+{
+	uncomp_size_t *len_ptr;
+	std::tie(std::ignore, len_ptr, std::ignore) = ptr_unpack(data);
+	return len_ptr;
+}
+
+/** As header_fields, for headers that must be versioned to be written */
+uncomp_size_t *versioned_fields(byte *data)
+{
+	if (!versioned(data)) {
+		throw std::logic_error("format: a header of the first format has no such field");
+	}
+	return header_fields(data);
+}
+
+}
+
+bool versioned(byte *data)
+{
+	if (!std::equal(std::begin(format_magic), std::end(format_magic), data)) {
+		return false;
+	}
+	auto version = data[sizeof(format_magic)];
+	if (version != format_version) {
+		throw std::runtime_error("Unsupported format version " + std::to_string(version));
+	}
+	return true;
+}
+
 pack_info pack(std::string enc_name, size_t orig_len, size_t comp_len)
 {
-	size_t data_len = comp_len + sizeof(uncomp_size_t) + enc_name.length() + 1;
+	size_t data_len = comp_len + format_prefix + 3 * sizeof(uncomp_size_t) + enc_name.length() + 1;
 	std::unique_ptr<byte[]> data_holder(new byte[data_len + 8]);
 	byte *data = data_holder.get();
 	std::fill(data, data + data_len + 8, 0U);
 
+	data = std::copy(std::begin(format_magic), std::end(format_magic), data);
+	*data++ = format_version;
 	data = std::copy(enc_name.begin(), enc_name.end(), data);
 	*data++ = '\0';
 
-	data = inject_size(data, orig_len);
+	data = inject_size<uncomp_size_t>(data, orig_len);
+	data = inject_size<uncomp_size_t>(data, 0U);
+	data = inject_size<uncomp_size_t>(data, 0U);
 	return {std::move(data_holder), data_len};
 }
 
 std::tuple<std::string, size_t, byte*> unpack(byte *data)
 {
+	bool current = versioned(data);
+	if (current) {
+		data += format_prefix;
+	}
 	const size_t max_enc_name = 20;
 	char enc_name[20];
 	std::strncpy(enc_name, const_cast<char*>(reinterpret_cast<char*>(data)), max_enc_name);
 	enc_name[max_enc_name - 1] = '\0';
 	data += strnlen(enc_name, max_enc_name) + 1;
 	size_t orig_size = extract_size(data, &data);
+	if (current) {
+		// Skips the in-place margin and the checksum block size
+		extract_size(data, &data);
+		extract_size(data, &data);
+	}
 	return std::make_tuple(std::string(enc_name), orig_size, data);
 }
 
@@ -59,7 +107,27 @@ std::tuple<char*, uncomp_size_t*, byte*> ptr_unpack(byte *data)
 	size_t size;
 	byte *start;
 	std::tie(enc_name, size, start) = unpack(data);
-	char *name_start = reinterpret_cast<char*>(data);
+	char *name_start = reinterpret_cast<char*>(data + (versioned(data) ? format_prefix : 0U));
 	uncomp_size_t *len_ptr = reinterpret_cast<uncomp_size_t*>(name_start + enc_name.length() + 1);
 	return std::make_tuple(name_start, len_ptr, start);
-}
\ No newline at end of file
+}
+
+uncomp_size_t in_place_margin(byte *data)
+{
+	return versioned(data) ? header_fields(data)[1] : 0U;
+}
+
+void set_in_place_margin(byte *data, size_t margin)
+{
+	versioned_fields(data)[1] = margin;
+}
+
+uncomp_size_t checksum_block(byte *data)
+{
+	return versioned(data) ? header_fields(data)[2] : 0U;
+}
+
+void set_checksum_block(byte *data, size_t block_size)
+{
+	versioned_fields(data)[2] = block_size;
+}
@@ -0,0 +1,274 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <graph_cache.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GROUP_VARINT_SHUFFLE
+#endif
+
+namespace {
+
+/** Bytes a single position can append to a level, at most */
+const size_t chunk_slack = 64U;
+
+/** Read-ahead window requested by prefetch() */
+const size_t prefetch_window = 4U << 20;
+
+std::string errno_msg(const std::string &what)
+{
+	return what + ": " + std::strerror(errno);
+}
+
+/** Decoding tables of group_varint, indexed by the control byte */
+struct group_tables {
+	byte data_len[256];
+	byte value_len[256][4];
+	byte shuffle[256][16];
+
+	group_tables()
+	{
+		const byte widths[] = {0U, 1U, 2U, 4U};
+		for (unsigned int ctrl = 0; ctrl < 256; ctrl++) {
+			byte offset = 0U;
+			for (unsigned int i = 0; i < 4; i++) {
+				auto width = widths[(ctrl >> (2 * i)) & 3U];
+				value_len[ctrl][i] = width;
+				for (unsigned int j = 0; j < 4; j++) {
+					// 0x80 zeroes the byte
+					shuffle[ctrl][4 * i + j] = j < width ? offset + j : 0x80;
+				}
+				offset += width;
+			}
+			data_len[ctrl] = offset;
+		}
+	}
+};
+
+const group_tables tables;
+
+const byte *decode_group(const byte *in, std::uint32_t *out)
+{
+	auto ctrl = *in++;
+	for (unsigned int i = 0; i < 4; i++) {
+		std::uint32_t value = 0U;
+		for (unsigned int j = 0; j < tables.value_len[ctrl][i]; j++) {
+			value |= static_cast<std::uint32_t>(*in++) << (8 * j);
+		}
+		out[i] = value;
+	}
+	return in;
+}
+
+#ifdef GROUP_VARINT_SHUFFLE
+/** Needs max_group_bytes readable bytes from in */
+__attribute__((target("ssse3")))
+const byte *decode_group_shuffle(const byte *in, std::uint32_t *out)
+{
+	auto ctrl = *in;
+	auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 1));
+	auto mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[ctrl]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(data, mask));
+	return in + 1 + tables.data_len[ctrl];
+}
+
+bool has_ssse3()
+{
+	// Runs before main: CPU detection must be initialized by hand
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+const bool use_shuffle = has_ssse3();
+#endif
+
+}
+
+namespace group_varint {
+
+const byte *decode_groups(const byte *in, const byte *limit, std::uint32_t *out, size_t groups)
+{
+#ifdef GROUP_VARINT_SHUFFLE
+	if (use_shuffle) {
+		for (; groups > 0 && limit - in >= static_cast<std::ptrdiff_t>(max_group_bytes); --groups, out += 4) {
+			in = decode_group_shuffle(in, out);
+		}
+	}
+#endif
+	for (; groups > 0; --groups, out += 4) {
+		assert(in + 1 + tables.data_len[*in] <= limit);
+		in = decode_group(in, out);
+	}
+	return in;
+}
+
+}
+
+struct cached_graph::spill_state {
+	std::string path;
+	size_t chunk_size;
+	int fd;
+	/** Bytes of each level already written to the file */
+	std::vector<size_t> flushed;
+
+	spill_state(std::string dir, size_t chunk_size)
+		: path(dir + "/bczip-graph-XXXXXX"), chunk_size(chunk_size), fd(-1)
+	{
+		std::vector<char> tmpl(path.begin(), path.end());
+		tmpl.push_back('\0');
+		fd = mkstemp(tmpl.data());
+		if (fd < 0) {
+			throw std::runtime_error(errno_msg("Unable to create spill file in " + dir));
+		}
+		// Nobody else needs it: the file goes away with the last descriptor/mapping
+		unlink(tmpl.data());
+	}
+
+	void write(const byte *data, size_t len, size_t offset)
+	{
+		while (len > 0) {
+			auto written = pwrite(fd, data, len, offset);
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::runtime_error(errno_msg("Unable to write spill file"));
+			}
+			data += written;
+			offset += written;
+			len -= written;
+		}
+	}
+
+	~spill_state()
+	{
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+};
+
+cached_graph::cached_graph(std::string spill_dir, size_t chunk_size)
+	: cached_graph()
+{
+	if (chunk_size == 0U) {
+		throw std::logic_error("cached_graph: chunk size must be positive");
+	}
+	spill_info = std::make_shared<spill_state>(spill_dir, chunk_size);
+}
+
+void cached_graph::set(size_t level_size, unsigned int levels)
+{
+	if (file_backed()) {
+		if (spill_info->fd < 0) {
+			throw std::logic_error("cached_graph: a sealed file-backed graph cannot be set again");
+		}
+		// The file has the in-memory layout, but stays sparse where nothing is written
+		if (ftruncate(spill_info->fd, levels * level_size) != 0) {
+			throw std::runtime_error(errno_msg("Unable to resize spill file"));
+		}
+		spill_info->flushed.assign(levels, 0U);
+		// Writers work on a chunk buffer per level until seal()
+		stride = spill_info->chunk_size + chunk_slack;
+		map_size = levels * level_size;
+		level_stride = level_size;
+	} else {
+		stride = level_size;
+	}
+	auto size = levels * stride;
+	data_hold.reset(new byte[size], std::default_delete<byte[]>());
+	auto ptr = data_hold.get();
+	std::fill(ptr, ptr + size, 0U);
+	end = ptr + size;
+}
+
+size_t cached_graph::spill(unsigned int idx, byte *head)
+{
+	auto &s = *spill_info;
+	auto begin = get_begin(idx);
+	assert(head >= begin && head < begin + stride);
+	if (static_cast<size_t>(head - begin) < s.chunk_size) {
+		return 0U;
+	}
+	if (s.flushed[idx] + s.chunk_size > level_stride) {
+		throw std::logic_error("cached_graph: level overflow while spilling");
+	}
+	s.write(begin, s.chunk_size, idx * level_stride + s.flushed[idx]);
+	s.flushed[idx] += s.chunk_size;
+	// Keep the partially written tail, including the byte under the head
+	auto chunk_end = begin + s.chunk_size;
+	auto tail_end = head + 1;
+	std::copy(chunk_end, tail_end, begin);
+	std::fill(begin + (tail_end - chunk_end), begin + stride, 0U);
+	return s.chunk_size;
+}
+
+void cached_graph::seal(const std::vector<byte*> &heads)
+{
+	auto &s = *spill_info;
+	if (s.fd < 0) {
+		throw std::logic_error("cached_graph: the graph is already sealed");
+	}
+	for (unsigned int i = 0; i < heads.size(); i++) {
+		auto begin = get_begin(i);
+		size_t len = heads[i] + 1 - begin;
+		if (s.flushed[i] + len > level_stride) {
+			throw std::logic_error("cached_graph: level overflow while spilling");
+		}
+		s.write(begin, len, i * level_stride + s.flushed[i]);
+		s.flushed[i] += len;
+	}
+	map_file();
+}
+
+void cached_graph::map_file()
+{
+	auto &s = *spill_info;
+	auto size = map_size;
+	void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, s.fd, 0);
+	if (addr == MAP_FAILED) {
+		throw std::runtime_error(errno_msg("Unable to map spill file"));
+	}
+	// Replays scan every level front to back
+	madvise(addr, size, MADV_SEQUENTIAL);
+	data_hold.reset(static_cast<byte*>(addr), [size](byte *p) { munmap(p, size); });
+	stride = level_stride;
+	end = data_hold.get() + size;
+	close(s.fd);
+	s.fd = -1;
+}
+
+void cached_graph::prefetch(byte *ptr)
+{
+	auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	auto base = data_hold.get();
+	size_t from = (ptr - base) / page * page;
+	if (from >= map_size) {
+		return;
+	}
+	auto len = std::min(prefetch_window, map_size - from);
+	madvise(base + from, len, MADV_WILLNEED);
+}
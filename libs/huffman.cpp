@@ -0,0 +1,241 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <huffman.hpp>
+
+#include <cassert>
+#include <queue>
+#include <utility>
+
+namespace huffman {
+
+namespace {
+
+std::array<size_t, 256> histogram(const byte *src, size_t len)
+{
+	std::array<size_t, 256> freqs;
+	freqs.fill(0U);
+	for (size_t i = 0; i < len; i++) {
+		freqs[src[i]]++;
+	}
+	return freqs;
+}
+
+/** Depths of the leaves of a Huffman tree for the (positive) weights */
+std::vector<unsigned int> leaf_depths(const std::vector<size_t> &weights)
+{
+	typedef std::pair<size_t, size_t> node;
+	std::priority_queue<node, std::vector<node>, std::greater<node>> queue;
+	auto leaves = weights.size();
+	std::vector<size_t> parent(2 * leaves - 1);
+	for (size_t i = 0; i < leaves; i++) {
+		queue.push(node(weights[i], i));
+	}
+	auto next = leaves;
+	while (queue.size() > 1) {
+		auto first = queue.top();
+		queue.pop();
+		auto second = queue.top();
+		queue.pop();
+		parent[first.second] = parent[second.second] = next;
+		queue.push(node(first.first + second.first, next++));
+	}
+	// Parents come after their children: depths are computed top-down
+	auto root = next - 1;
+	std::vector<unsigned int> depth(next, 0U);
+	for (auto i = root; i-- > 0;) {
+		depth[i] = depth[parent[i]] + 1;
+	}
+	depth.resize(leaves);
+	return depth;
+}
+
+/** Codewords of the canonical code with the given lengths, bit-reversed (LSB-first) */
+std::array<std::uint16_t, 256> canonical_codes(const code_lengths &lengths)
+{
+	std::array<unsigned int, max_code_len + 1> count;
+	count.fill(0U);
+	for (auto len : lengths) {
+		count[len]++;
+	}
+	count[0] = 0;
+	std::array<unsigned int, max_code_len + 1> next_code;
+	unsigned int code = 0;
+	for (unsigned int len = 1; len <= max_code_len; len++) {
+		code = (code + count[len - 1]) << 1;
+		next_code[len] = code;
+	}
+	std::array<std::uint16_t, 256> codes;
+	codes.fill(0U);
+	for (unsigned int c = 0; c < 256; c++) {
+		auto len = lengths[c];
+		if (len == 0) {
+			continue;
+		}
+		auto canonical = next_code[len]++;
+		std::uint16_t reversed = 0;
+		for (unsigned int b = 0; b < len; b++) {
+			reversed |= ((canonical >> b) & 1U) << (len - 1 - b);
+		}
+		codes[c] = reversed;
+	}
+	return codes;
+}
+
+template <typename T>
+void append(std::vector<byte> &dest, T value)
+{
+	auto size = dest.size();
+	dest.resize(size + sizeof(value));
+	std::memcpy(dest.data() + size, &value, sizeof(value));
+}
+
+void encode_block(const byte *src, std::uint32_t len, std::vector<byte> &dest)
+{
+	auto freqs = histogram(src, len);
+	auto lengths = build_lengths(freqs);
+	size_t bits = 0;
+	for (unsigned int c = 0; c < 256; c++) {
+		bits += freqs[c] * lengths[c];
+	}
+	std::uint32_t payload = (bits + 7) / 8;
+	if (payload + 128U >= len) {
+		dest.push_back(RAW);
+		append(dest, len);
+		append(dest, len);
+		dest.insert(dest.end(), src, src + len);
+		return;
+	}
+	dest.push_back(HUFFMAN);
+	append(dest, len);
+	append(dest, payload);
+	for (unsigned int c = 0; c < 256; c += 2) {
+		dest.push_back(lengths[c] | (lengths[c + 1] << 4));
+	}
+	auto codes = canonical_codes(lengths);
+#ifndef NDEBUG
+	auto start = dest.size();
+#endif
+	std::uint64_t buffer = 0U;
+	unsigned int count = 0;
+	for (std::uint32_t i = 0; i < len; i++) {
+		buffer |= std::uint64_t(codes[src[i]]) << count;
+		count += lengths[src[i]];
+		while (count >= 8) {
+			dest.push_back(buffer);
+			buffer >>= 8;
+			count -= 8;
+		}
+	}
+	if (count > 0) {
+		dest.push_back(buffer);
+	}
+	assert(dest.size() - start == payload);
+}
+
+}
+
+code_lengths build_lengths(const std::array<size_t, 256> &freqs)
+{
+	code_lengths lengths;
+	lengths.fill(0U);
+	std::vector<size_t> weights;
+	std::vector<unsigned int> symbols;
+	for (unsigned int c = 0; c < 256; c++) {
+		if (freqs[c] > 0) {
+			weights.push_back(freqs[c]);
+			symbols.push_back(c);
+		}
+	}
+	if (symbols.empty()) {
+		return lengths;
+	}
+	if (symbols.size() == 1) {
+		lengths[symbols[0]] = 1U;
+		return lengths;
+	}
+	// Flatten the frequencies until the code fits max_code_len
+	for (;;) {
+		auto depths = leaf_depths(weights);
+		if (*std::max_element(depths.begin(), depths.end()) <= max_code_len) {
+			for (size_t i = 0; i < symbols.size(); i++) {
+				lengths[symbols[i]] = depths[i];
+			}
+			return lengths;
+		}
+		for (auto &w : weights) {
+			w = (w + 1) / 2;
+		}
+	}
+}
+
+void encode(const byte *src, size_t len, std::vector<byte> &dest)
+{
+	for (size_t i = 0; i < len; i += block_size) {
+		encode_block(src + i, std::min(block_size, len - i), dest);
+	}
+}
+
+double symbol_cost(const byte *text, size_t len)
+{
+	double headers = 8.0 * block_header_size / block_size;
+	if (len == 0) {
+		return 8.0 + headers;
+	}
+	auto freqs = histogram(text, len);
+	auto lengths = build_lengths(freqs);
+	double bits = 0;
+	for (unsigned int c = 0; c < 256; c++) {
+		bits += static_cast<double>(freqs[c]) * lengths[c];
+	}
+	return std::min(8.0, bits / len) + headers;
+}
+
+void block_reader::load_block()
+{
+	auto mode = *next_block;
+	std::uint32_t symbols, payload;
+	std::memcpy(&symbols, next_block + 1, sizeof(symbols));
+	std::memcpy(&payload, next_block + 1 + sizeof(symbols), sizeof(payload));
+	auto data = next_block + 1 + 2 * sizeof(std::uint32_t);
+	left = symbols;
+	raw = mode == RAW;
+	if (raw) {
+		raw_data = data;
+		next_block = data + payload;
+		return;
+	}
+	code_lengths lengths;
+	for (unsigned int c = 0; c < 256; c += 2) {
+		lengths[c] = data[c / 2] & 0xFU;
+		lengths[c + 1] = data[c / 2] >> 4;
+	}
+	auto codes = canonical_codes(lengths);
+	for (unsigned int c = 0; c < 256; c++) {
+		auto len = lengths[c];
+		if (len == 0) {
+			continue;
+		}
+		std::uint16_t entry = c | (len << 8);
+		for (size_t i = codes[c]; i < table.size(); i += size_t(1) << len) {
+			table[i] = entry;
+		}
+	}
+	bits = unaligned_io::bit_reader(data + 128U);
+	next_block = data + 128U + payload;
+}
+
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <match_integrator.hpp>
+
+#include <algorithm>
+
+match_integrator::match_integrator(text_info ti, sa_getter &sa_get, const cost_model &cm)
+	: text(ti.text.get()), t_len(ti.len), dsts(cm.get_dst()), sa(sa_get.get(text, text + t_len))
+{
+	std::vector<std::uint32_t> ranks(t_len);
+	for (size_t r = 0; r < t_len; r++) {
+		ranks[(*sa)[r]] = r;
+	}
+	isa = wavelet_matrix(ranks);
+}
+
+unsigned int match_integrator::distance(size_t pos, unsigned int dst, unsigned int len) const
+{
+	auto bound = std::lower_bound(dsts.begin(), dsts.end(), dst);
+	if (bound == dsts.end() || pos + len > t_len) {
+		throw std::logic_error("match_integrator: edge out of the cost model");
+	}
+	if (dst <= pos && std::equal(text + pos, text + pos + len, text + pos - dst)) {
+		return dst;
+	}
+	// Sources at a distance in the class of dst
+	size_t first = pos > *bound ? pos - *bound : 0U;
+	size_t last = bound == dsts.begin() ? pos : pos - std::min<size_t>(pos, *std::prev(bound));
+	std::uint64_t rank = isa.access(pos);
+	for (auto found : {isa.prev_value(first, last, rank), isa.next_value(first, last, rank + 1)}) {
+		if (found == wavelet_matrix::npos) {
+			continue;
+		}
+		size_t src = (*sa)[found];
+		if (std::equal(text + pos, text + pos + len, text + src)) {
+			return pos - src;
+		}
+	}
+	throw std::logic_error("match_integrator: a fixable edge found no match");
+}
@@ -0,0 +1,237 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <memory_planner.hpp>
+
+#include <edges.hpp>
+#include <facilities.hpp>
+#include <fast_fsg.hpp>
+#include <graph_cache.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/** Chunk buffer of every level of a spilled graph (cached_graph's default) */
+const size_t spill_chunk = (1U << 20) + 64U;
+
+/**
+ * RSA entries alive per entry of the RSAs: the queues also keep the blocks of
+ * their sliding windows (calibrated on the peak footprint of ffsg_fact and
+ * gen_ffsg_fact)
+ */
+const double rsa_queue_overhead = 2.75;
+
+/** Bytes per RSA entry, in blocks of capacity entries of a t_len-byte text (see rsa_block) */
+double rsa_entry_bytes(size_t capacity, size_t t_len)
+{
+	typedef rsa_block<std::int32_t> block_t;
+	auto block_bytes = block_t::units(capacity, t_len) * sizeof(block_t::unit_type);
+	return rsa_queue_overhead * block_bytes / capacity;
+}
+
+/** Buckets whose generator is alive at once in bucket_fsg (current + one built ahead) */
+const size_t live_buckets = 2U;
+
+/** Upper bound of a compressed parsing of t_len bytes */
+size_t parsing_bound(size_t t_len)
+{
+	return t_len + t_len / 8 + 64U;
+}
+
+double graph_expansion(graph_encoding enc)
+{
+	switch (enc) {
+	case UNARY_GRAPH:
+		return unary_gammalike::encoder<nibble::class_desc, byte>::ub_gamma();
+	case GROUP_VARINT_GRAPH:
+		return group_varint::encoder::ub_gamma();
+	}
+	throw std::logic_error("Unknown graph encoding");
+}
+
+std::string to_mb(size_t bytes)
+{
+	return join_s(bytes >> 20, "MB");
+}
+
+}
+
+std::string encoding_name(graph_encoding enc)
+{
+	return enc == UNARY_GRAPH ? "unary" : "group-varint";
+}
+
+std::ostream &operator<<(std::ostream &os, const memory_estimate &est)
+{
+	return os << to_mb(est.total()) << " ("
+		<< "runtime " << to_mb(est.runtime)
+		<< ", text " << to_mb(est.text)
+		<< ", SA " << to_mb(est.suffix_arrays)
+		<< ", RSA " << to_mb(est.rsa)
+		<< ", DP " << to_mb(est.dp)
+		<< ", graph " << to_mb(est.graph)
+		<< ", parsings " << to_mb(est.parsings) << ")";
+}
+
+memory_planner::memory_planner(size_t t_len, const cost_model &cm)
+	: t_len(t_len), dst(cm.get_dst())
+{
+
+}
+
+size_t memory_planner::graph_levels() const
+{
+	// As in caching_fsg_fact
+	return 1 + std::distance(dst.begin(), std::lower_bound(dst.begin(), dst.end(), t_len));
+}
+
+size_t memory_planner::generator_size(size_t len) const
+{
+	// RSA entries: the last level covers the whole text, every other one at
+	// most two cost classes past its distance (see rsa_getter::build_queue)
+	if (len == 0U) {
+		return 0U;
+	}
+	double rsa_bytes = len * rsa_entry_bytes(len, len);
+	for (auto d : dst) {
+		if (d >= len) {
+			break;
+		}
+		rsa_bytes += std::min<size_t>(len, 2U * static_cast<size_t>(d)) * rsa_entry_bytes(d, len);
+	}
+	// Plus the merged RSA handed to the generator
+	return 3 * len * sizeof(std::int32_t) + static_cast<size_t>(std::ceil(rsa_bytes));
+}
+
+memory_estimate memory_planner::bicriteria(graph_encoding enc, bool spill, size_t cache_capacity, size_t threads) const
+{
+	memory_estimate est;
+	est.text = t_len;
+	// The peak is the caching pass: the SA of the solution integrator is
+	// built later, once the generator has been released
+	est.suffix_arrays = t_len * sizeof(std::int32_t);
+	est.rsa = generator_size(t_len) - 2 * t_len * sizeof(std::int32_t);
+	// Parsing and costs; the parallel parser adds per-segment copies
+	est.dp = t_len * (sizeof(edge_t) + sizeof(bi_edge_cost));
+	if (threads > 1U) {
+		est.dp += t_len * (sizeof(edge_t) + sizeof(bi_edge_cost));
+	}
+	if (spill) {
+		est.graph = graph_levels() * spill_chunk;
+	} else {
+		est.graph = graph_levels() * static_cast<size_t>(std::ceil(graph_expansion(enc) * t_len * 2));
+	}
+	// Cached parsings, plus the two being integrated
+	est.parsings = (cache_capacity + 2) * parsing_bound(t_len);
+	return est;
+}
+
+bicriteria_plan memory_planner::plan_bicriteria(size_t budget, bool can_spill, size_t threads) const
+{
+	// From the fastest to the leanest
+	std::vector<bicriteria_plan> candidates = {
+		{GROUP_VARINT_GRAPH, false, 3U, memory_estimate()},
+		{UNARY_GRAPH, false, 3U, memory_estimate()},
+		{UNARY_GRAPH, false, 1U, memory_estimate()}
+	};
+	if (can_spill) {
+		candidates.push_back({UNARY_GRAPH, true, 3U, memory_estimate()});
+		candidates.push_back({UNARY_GRAPH, true, 1U, memory_estimate()});
+	}
+	for (auto &c : candidates) {
+		c.estimate = bicriteria(c.encoding, c.spill, c.cache_capacity, threads);
+		if (c.estimate.total() <= budget) {
+			return c;
+		}
+	}
+	throw std::runtime_error(join_s(
+		"Memory budget of ", to_mb(budget), " too small: at least ",
+		candidates.back().estimate, " needed"
+	));
+}
+
+memory_estimate memory_planner::bucketed(size_t bucket_size) const
+{
+	memory_estimate est;
+	est.text = t_len;
+	// Parsing and costs span the whole text anyway
+	est.dp = t_len * (sizeof(edge_t) + sizeof(edge_cost));
+	// Every bucket is generated together with its history window
+	bool bucketing = bucket_size > 0U && bucket_size < t_len;
+	auto len = bucketing ? std::min(t_len, bucket_size + std::min<size_t>(bucket_size, dst.back())) : t_len;
+	auto live = bucketing ? live_buckets : 1U;
+	est.suffix_arrays = live * 2 * len * sizeof(std::int32_t);
+	est.rsa = live * generator_size(len) - est.suffix_arrays;
+	return est;
+}
+
+size_t memory_planner::plan_bucket(size_t budget, size_t granularity) const
+{
+	if (bucketed(0U).total() <= budget) {
+		return 0U;
+	}
+	// Footprint grows with the bucket size: binary search on multiples of granularity
+	size_t lo = 1U, hi = std::max<size_t>(1U, t_len / granularity);
+	if (bucketed(lo * granularity).total() > budget) {
+		throw std::runtime_error(join_s(
+			"Memory budget of ", to_mb(budget), " too small: at least ",
+			bucketed(lo * granularity), " needed"
+		));
+	}
+	while (lo < hi) {
+		auto mid = lo + (hi - lo + 1) / 2;
+		if (bucketed(mid * granularity).total() <= budget) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo * granularity;
+}
+
+size_t parse_memory_size(const std::string &str)
+{
+	size_t pos = 0;
+	double value;
+	try {
+		value = std::stod(str, &pos);
+	} catch (std::exception &) {
+		throw std::runtime_error(join_s("Invalid memory size: ", str));
+	}
+	size_t multiplier = 1U;
+	if (pos < str.size()) {
+		switch (std::toupper(str[pos++])) {
+		case 'T': multiplier <<= 10; // fall through
+		case 'G': multiplier <<= 10; // fall through
+		case 'M': multiplier <<= 10; // fall through
+		case 'K': multiplier <<= 10;
+			break;
+		default:
+			throw std::runtime_error(join_s("Invalid memory size: ", str));
+		}
+	}
+	// Also rejects NaN, and sizes beyond the address space
+	auto bytes = value * multiplier;
+	if (pos != str.size() || !(bytes >= 1) || !(bytes < std::ldexp(1.0, std::numeric_limits<size_t>::digits))) {
+		throw std::runtime_error(join_s("Invalid memory size: ", str));
+	}
+	return static_cast<size_t>(bytes);
+}
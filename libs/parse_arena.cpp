@@ -0,0 +1,117 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <parse_arena.hpp>
+
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+namespace {
+
+/** Size of a transparent huge page on the targets we care about */
+const size_t huge_page = 2U << 20;
+
+/**
+ * Asks for huge pages on the pages fully within [addr, addr + bytes): with
+ * 4KB pages, faulting in a multi-GB array costs a fault every 4KB.
+ */
+void advise_huge_pages(void *addr, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+	auto begin = (reinterpret_cast<std::uintptr_t>(addr) + huge_page - 1) / huge_page * huge_page;
+	auto end = (reinterpret_cast<std::uintptr_t>(addr) + bytes) / huge_page * huge_page;
+	if (begin < end) {
+		// Only a hint: without transparent huge pages it just fails
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+	}
+#else
+	(void) addr;
+	(void) bytes;
+#endif
+}
+
+}
+
+parse_arena::parse_arena() : block(nullptr), block_size(0U)
+{
+
+}
+
+parse_arena::~parse_arena()
+{
+	unmap();
+}
+
+void parse_arena::unmap()
+{
+	if (block != nullptr) {
+		munmap(block, block_size);
+		block = nullptr;
+		block_size = 0U;
+	}
+}
+
+std::vector<edge_t> parse_arena::parsing(size_t len)
+{
+	if (parsings.empty()) {
+		return std::vector<edge_t>(len);
+	}
+	auto to_ret = std::move(parsings.back());
+	parsings.pop_back();
+	to_ret.assign(len, edge_t());
+	return to_ret;
+}
+
+void parse_arena::recycle(phrase_list &&phrases)
+{
+	auto parsing = phrases.release();
+	if (parsing.capacity() == 0U) {
+		return;
+	}
+	advise_huge_pages(parsing.data(), parsing.capacity() * sizeof(edge_t));
+	parsings.push_back(std::move(parsing));
+	// One spare parsing is enough for the next parse
+	if (parsings.size() > 1U) {
+		parsings.erase(parsings.begin());
+	}
+}
+
+void *parse_arena::reserve(size_t bytes)
+{
+	if (bytes <= block_size) {
+		return block;
+	}
+	unmap();
+	auto size = (bytes + huge_page - 1) / huge_page * huge_page;
+	void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	advise_huge_pages(addr, size);
+	block = static_cast<byte*>(addr);
+	block_size = size;
+	return block;
+}
+
+void parse_arena::release()
+{
+	unmap();
+	parsings.clear();
+	parsings.shrink_to_fit();
+}
@@ -47,7 +47,7 @@ public:
 
 };
 
-std::vector<edge_t> path_swap(
+phrase_list path_swap(
 		std::string encoder_name,
 		parsing p_1, double cost_1, double weight_1,
 		parsing p_2, double cost_2, double weight_2,
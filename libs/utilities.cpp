@@ -126,14 +126,13 @@ std::vector<unsigned int> normalize_dst(const std::vector<unsigned int> &dst, si
 
 
 
-correctness_report check_correctness(const std::vector<edge_t> &sol, byte *start)
+correctness_report check_correctness(const phrase_list &sol, byte *start)
 {
 	byte *ptr = start;
-	auto end = std::prev(sol.end(), 1);
-	for (auto it = sol.begin(); it != end; ptr += it->ell, std::advance(it, it->ell)) {
+	for (auto it = sol.begin(); it != sol.end(); ptr += it->ell, ++it) {
 		edge_t edge = *it;
 		if (	ptr - edge.d < start ||
-				ptr + edge.ell >= start + sol.size() ||
+				ptr + edge.ell > start + sol.text_length() ||
 				!std::equal(ptr, ptr + edge.ell, ptr - edge.d)
 		)
 		{
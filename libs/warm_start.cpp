@@ -0,0 +1,102 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <warm_start.hpp>
+
+#include <facilities.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char header[] = "# bound\tencoder\ttarget\tlambda\tleft_lambda\tright_lambda\tleft_space\tleft_time\tright_space\tright_time";
+
+}
+
+warm_start_file::warm_start_file(std::string path) : path(path)
+{
+	std::ifstream in(path);
+	if (!in) {
+		return;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		warm_start_entry e;
+		std::getline(fields, e.bound, '\t');
+		std::getline(fields, e.encoder, '\t');
+		std::getline(fields, e.target, '\t');
+		fields >> e.lambda >> e.left_lambda >> e.right_lambda
+			>> e.left_space >> e.left_time >> e.right_space >> e.right_time;
+		// A start that is only a hint: a damaged line is not worth failing for
+		if (fields && !e.bound.empty() && !e.encoder.empty()) {
+			entries.push_back(e);
+		}
+	}
+}
+
+bool warm_start_file::find(const std::string &bound, const std::string &encoder, const std::string &target, warm_start_entry *entry) const
+{
+	warm_start_key key(bound, encoder, target);
+	for (auto &e : entries) {
+		if (e.key() == key) {
+			*entry = e;
+			return true;
+		}
+	}
+	return false;
+}
+
+void warm_start_file::store(const warm_start_entry &entry)
+{
+	bool found = false;
+	for (auto &e : entries) {
+		if (e.key() == entry.key()) {
+			e = entry;
+			found = true;
+		}
+	}
+	if (!found) {
+		entries.push_back(entry);
+	}
+
+	// Written aside and renamed, not to leave a truncated file behind
+	auto tmp_path = path + ".tmp";
+	{
+		std::ofstream out(tmp_path);
+		// λs must read back exactly, to give back the same cost models
+		out.precision(std::numeric_limits<double>::max_digits10);
+		out << header << '\n';
+		for (auto &e : entries) {
+			out << e.bound << '\t' << e.encoder << '\t' << e.target << '\t'
+				<< e.lambda << '\t' << e.left_lambda << '\t' << e.right_lambda << '\t'
+				<< e.left_space << '\t' << e.left_time << '\t' << e.right_space << '\t' << e.right_time << '\n';
+		}
+		if (!out.flush()) {
+			throw std::runtime_error(join_s("Cannot write warm start file ", tmp_path));
+		}
+	}
+	if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		throw std::runtime_error(join_s("Cannot write warm start file ", path));
+	}
+}
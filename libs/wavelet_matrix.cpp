@@ -0,0 +1,207 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <wavelet_matrix.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+/** Bits covered by an entry of wavelet_matrix::level::ranks */
+const size_t rank_block_bits = 512U;
+
+size_t popcount(std::uint64_t x)
+{
+	return __builtin_popcountll(x);
+}
+
+}
+
+const std::uint64_t wavelet_matrix::npos;
+
+size_t wavelet_matrix::level::rank0(size_t i) const
+{
+	auto word = i >> 6;
+	size_t ones = ranks[i / rank_block_bits];
+	for (size_t w = i / rank_block_bits * (rank_block_bits / 64); w < word; w++) {
+		ones += popcount(bits[w]);
+	}
+	if ((i & 63U) != 0) {
+		ones += popcount(bits[word] & ((std::uint64_t(1) << (i & 63U)) - 1));
+	}
+	return i - ones;
+}
+
+wavelet_matrix::wavelet_matrix(const std::vector<std::uint32_t> &values)
+	: n(values.size()), width(0)
+{
+	std::uint32_t max = 0;
+	for (auto v : values) {
+		max = std::max(max, v);
+	}
+	while (width < 32 && (max >> width) != 0) {
+		++width;
+	}
+	levels.resize(width);
+	auto cur = values;
+	std::vector<std::uint32_t> next(n);
+	for (unsigned int l = 0; l < width; l++) {
+		auto shift = width - 1 - l;
+		auto &lv = levels[l];
+		// One padding word, for rank0(n) when n is a multiple of 64
+		lv.bits.assign(n / 64 + 1, 0U);
+		size_t zeros = 0;
+		for (size_t i = 0; i < n; i++) {
+			if ((cur[i] >> shift) & 1U) {
+				lv.bits[i >> 6] |= std::uint64_t(1) << (i & 63U);
+			} else {
+				next[zeros++] = cur[i];
+			}
+		}
+		lv.zeros = zeros;
+		// Stable partition: zeros first, then ones
+		for (size_t i = 0, ones = zeros; i < n; i++) {
+			if ((cur[i] >> shift) & 1U) {
+				next[ones++] = cur[i];
+			}
+		}
+		size_t ones = 0;
+		for (size_t w = 0; w < lv.bits.size(); w++) {
+			if (w % (rank_block_bits / 64) == 0) {
+				lv.ranks.push_back(ones);
+			}
+			ones += popcount(lv.bits[w]);
+		}
+		cur.swap(next);
+	}
+}
+
+std::uint32_t wavelet_matrix::access(size_t i) const
+{
+	assert(i < n);
+	std::uint32_t value = 0;
+	for (auto &lv : levels) {
+		if (lv.get(i)) {
+			value = (value << 1) | 1U;
+			i = lv.zeros + lv.rank1(i);
+		} else {
+			value <<= 1;
+			i = lv.rank0(i);
+		}
+	}
+	return value;
+}
+
+std::uint64_t wavelet_matrix::min_value(unsigned int l, size_t a, size_t b, std::uint64_t prefix) const
+{
+	for (; l < width; l++) {
+		auto &lv = levels[l];
+		auto a0 = lv.rank0(a), b0 = lv.rank0(b);
+		if (a0 < b0) {
+			a = a0;
+			b = b0;
+			prefix <<= 1;
+		} else {
+			a = lv.zeros + a - a0;
+			b = lv.zeros + b - b0;
+			prefix = (prefix << 1) | 1U;
+		}
+	}
+	return prefix;
+}
+
+std::uint64_t wavelet_matrix::max_value(unsigned int l, size_t a, size_t b, std::uint64_t prefix) const
+{
+	for (; l < width; l++) {
+		auto &lv = levels[l];
+		auto a0 = lv.rank0(a), b0 = lv.rank0(b);
+		if (b - b0 > a - a0) {
+			a = lv.zeros + a - a0;
+			b = lv.zeros + b - b0;
+			prefix = (prefix << 1) | 1U;
+		} else {
+			a = a0;
+			b = b0;
+			prefix <<= 1;
+		}
+	}
+	return prefix;
+}
+
+std::uint64_t wavelet_matrix::next_value(unsigned int l, size_t a, size_t b, std::uint64_t x, std::uint64_t prefix) const
+{
+	if (a >= b) {
+		return npos;
+	}
+	if (l == width) {
+		return prefix;
+	}
+	auto &lv = levels[l];
+	auto a0 = lv.rank0(a), b0 = lv.rank0(b);
+	auto a1 = lv.zeros + a - a0, b1 = lv.zeros + b - b0;
+	if ((x >> (width - 1 - l)) & 1U) {
+		return next_value(l + 1, a1, b1, x, (prefix << 1) | 1U);
+	}
+	auto found = next_value(l + 1, a0, b0, x, prefix << 1);
+	if (found != npos || a1 >= b1) {
+		return found;
+	}
+	// Every value in the ones is greater than x
+	return min_value(l + 1, a1, b1, (prefix << 1) | 1U);
+}
+
+std::uint64_t wavelet_matrix::prev_value(unsigned int l, size_t a, size_t b, std::uint64_t x, std::uint64_t prefix) const
+{
+	if (a >= b) {
+		return npos;
+	}
+	if (l == width) {
+		return prefix;
+	}
+	auto &lv = levels[l];
+	auto a0 = lv.rank0(a), b0 = lv.rank0(b);
+	auto a1 = lv.zeros + a - a0, b1 = lv.zeros + b - b0;
+	if (((x >> (width - 1 - l)) & 1U) == 0) {
+		return prev_value(l + 1, a0, b0, x, prefix << 1);
+	}
+	auto found = prev_value(l + 1, a1, b1, x, (prefix << 1) | 1U);
+	if (found != npos || a0 >= b0) {
+		return found;
+	}
+	// Every value in the zeros is smaller than x
+	return max_value(l + 1, a0, b0, prefix << 1);
+}
+
+std::uint64_t wavelet_matrix::next_value(size_t a, size_t b, std::uint64_t x) const
+{
+	b = std::min(b, n);
+	if (a >= b || (x >> width) != 0) {
+		return npos;
+	}
+	return next_value(0, a, b, x, 0);
+}
+
+std::uint64_t wavelet_matrix::prev_value(size_t a, size_t b, std::uint64_t x) const
+{
+	b = std::min(b, n);
+	if (a >= b || x == 0) {
+		return npos;
+	}
+	// Greatest value <= x - 1, which may be above the values stored
+	auto y = std::min<std::uint64_t>(x - 1, (std::uint64_t(1) << width) - 1);
+	return prev_value(0, a, b, y, 0);
+}
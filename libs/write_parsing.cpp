@@ -17,7 +17,9 @@
 #include <write_parsing.hpp>
 #include <encoders.hpp>
 
-void write_parsing(std::vector<edge_t> &sol, text_info ti, std::string file_name, std::string encoder_name)
+#include <cstring>
+
+void write_parsing(const phrase_list &sol, text_info ti, std::string file_name, std::string encoder_name)
 {
 	writer_factory fact;
 	encoders_().instantiate<base_writer, writer_factory>(encoder_name, fact)->write(file_name, ti, sol);
@@ -25,13 +27,13 @@ void write_parsing(std::vector<edge_t> &sol, text_info ti, std::string file_name
 
 class base_p_writer {
 public:
-	virtual compressed_file write(const std::vector<edge_t> &sol, size_t parsing_length, text_info ti) = 0;
+	virtual compressed_file write(const phrase_list &sol, size_t parsing_length, text_info ti) = 0;
 };
 
 template <typename enc_>
 class true_p_writer : public base_p_writer {
 public:
-	compressed_file write(const std::vector<edge_t> &sol, size_t parsing_length, text_info ti)
+	compressed_file write(const phrase_list &sol, size_t parsing_length, text_info ti)
 	{
 		return write_parsing<enc_>(sol, parsing_length, ti);
 	}
@@ -46,10 +48,10 @@ public:
 	}
 };
 
-compressed_file write_parsing(const std::vector<edge_t> &sol, text_info ti, std::string encoder_name, cost_model space_cm)
+compressed_file write_parsing(const phrase_list &sol, text_info ti, std::string encoder_name, cost_model space_cm)
 {
 	// (1) get parsing length
-	auto p_len = parsing_length<size_t>(ITERS(sol), space_cm);
+	auto p_len = parsing_length<size_t>(sol, space_cm);
 	// (2) get writer object
 	w_fact fact;
 	auto w_obj = encoders_().instantiate<base_p_writer, w_fact>(encoder_name, fact);
@@ -57,16 +59,57 @@ compressed_file write_parsing(const std::vector<edge_t> &sol, text_info ti, std:
 	return w_obj->write(sol, p_len, ti);
 }
 
-compressed_file write_parsing(const std::vector<edge_t> &sol, text_info ti, std::string encoder_name)
+compressed_file write_parsing(const phrase_list &sol, text_info ti, std::string encoder_name)
 {
 	cost_model space_cm = encoders_().get_cm(encoder_name);
 	return write_parsing(sol, ti, encoder_name, space_cm);
 }
 
-void write_parsing(
-	std::string enc_name, const std::vector<edge_t> &sol, size_t parsing_length, text_info ti, byte *output
+size_t write_parsing(
+	std::string enc_name, const phrase_list &sol, size_t parsing_length, text_info ti, byte *output
 )
 {
 	generic_parsing_writer func(sol, parsing_length, ti, output);
 	encoders_().call(enc_name, func);
-}
\ No newline at end of file
+	return func.written;
+}
+namespace {
+
+class margin_getter {
+private:
+	const phrase_list &sol;
+	size_t comp_len;
+public:
+	size_t margin;
+
+	margin_getter(const phrase_list &sol, size_t comp_len) : sol(sol), comp_len(comp_len), margin(0)
+	{
+
+	}
+
+	template <typename enc_>
+	void run()
+	{
+		margin = in_place_margin<enc_>(sol, comp_len);
+	}
+};
+
+}
+
+size_t in_place_margin(std::string enc_name, const phrase_list &sol, size_t comp_len)
+{
+	margin_getter getter(sol, comp_len);
+	encoders_().call(enc_name, getter);
+	return getter.margin;
+}
+
+void add_checksums(compressed_file &file, const block_checksums &checksums)
+{
+	auto sums_len = checksums.sums.size() * sizeof(std::uint32_t);
+	std::unique_ptr<byte[]> data(new byte[file.total_size + sums_len]);
+	std::copy(file.data.get(), file.data.get() + file.total_size, data.get());
+	std::memcpy(data.get() + file.total_size, checksums.sums.data(), sums_len);
+	set_checksum_block(data.get(), checksums.block_size);
+	file.data = std::move(data);
+	file.total_size += sums_len;
+}
@@ -21,6 +21,7 @@
 #include <memory>
 #include <signal.h>
 
+#include <bench.hpp>
 #include <bit_compress.hpp>
 #include <bicriteria_compress.hpp>
 #include <decompress.hpp>
@@ -43,12 +44,13 @@ int main(int argc, char *argv[])
 {
 	// List of commands
 	const char    *compress    = "compress",      *decompress = "decompress",
-			*bit_optimal = "bit-optimal",   *encoders       = "encoders",  *fsgs = "gens";
+			*bit_optimal = "bit-optimal",   *encoders       = "encoders",  *fsgs = "gens",
+			*benchmark   = "bench";
 	// Manage the command-line options
 	if (argc < 2) {
 		error_message("Must specify a command");
 		std::cerr << "Commands:\n";
-		std::cerr << compress << "\t" << decompress << "\t" << bit_optimal << "\t" << encoders << "\t" << fsgs << std::endl;
+		std::cerr << compress << "\t" << decompress << "\t" << bit_optimal << "\t" << encoders << "\t" << fsgs << "\t" << benchmark << std::endl;
 		return 0;
 	}
 
@@ -64,10 +66,12 @@ int main(int argc, char *argv[])
 			list_encoders();
 		} else if (strcmp(command, fsgs) == 0){
 			list_generators();
+		} else if (strcmp(command, benchmark) == 0) {
+			bench(benchmark, argc, argv);
 		} else {
 			error_message("Invalid command");
 			std::cerr << "Commands:\n";
-			std::cerr << compress << "\t" << decompress << "\t" << bit_optimal << "\t" << encoders << "\t" << fsgs << std::endl;
+			std::cerr << compress << "\t" << decompress << "\t" << bit_optimal << "\t" << encoders << "\t" << fsgs << "\t" << benchmark << std::endl;
 		}
 	} catch (cmd_error &e) {
 		std::stringstream what;
@@ -77,5 +81,9 @@ int main(int argc, char *argv[])
 	} catch (std::logic_error &e) {
 		std::cout << "LOGIC ERROR while processing." << std::endl;
 		std::cout << "Cause: " << e.what() << std::endl;
+	} catch (std::runtime_error &e) {
+		// Failed checks included, e.g. the checksums of decompress --verify
+		error_message(e.what());
+		return 1;
 	}
 }
@@ -17,12 +17,19 @@
 #include <iostream>
 #include <string>
 #include <memory>
+#include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <vector>
 
 #include <api.hpp>
+#include <decompress.hpp>
+#include <format.hpp>
+#include <write_parsing.hpp>
 #include <phrase_reader.hpp>
 #include <gtest/gtest.h>
 #include <io.hpp>
+#include <encoders.hpp>
 
 class config {
 public:
@@ -200,6 +207,217 @@ void fix_parsing()
 
 }
 
+/** A time model with the classes of the encoder, where farther copies are slower */
+cost_model time_model(const std::string &enc_name)
+{
+	auto space_cm = encoders_().get_cm(enc_name);
+	auto dsts = space_cm.get_dst();
+	auto lens = space_cm.get_len();
+	cost_matrix costs(dsts.size(), lens.size());
+	for (auto dst_idx = 0U; dst_idx < dsts.size(); dst_idx++) {
+		for (auto len_idx = 0U; len_idx < lens.size(); len_idx++) {
+			costs(dst_idx, len_idx) = 10.0 + 40.0 * dst_idx + len_idx;
+		}
+	}
+	return cost_model(dsts, lens, costs, 10.0, 1.0);
+}
+
+void compress_bounded_test()
+{
+	auto enc_name = config::encoder;
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	auto tm = time_model(enc_name);
+
+	// From the fastest to the smallest parsing
+	std::vector<size_t> spaces;
+	std::vector<double> times;
+	for (auto level : {0.0, 0.5, 1.0}) {
+		size_t comp_len, space;
+		double time;
+		auto compressed = bczip::compress_bounded(
+			enc_name.c_str(), tm, bczip::compression_bound::time_level(level),
+			text_ptr, text_len, &comp_len, &space, &time
+		);
+		size_t dec_len;
+		auto dec_ptr = bczip::decompress(compressed.get(), &dec_len);
+		ASSERT_EQ(dec_len, text_len);
+		check_equal(text_ptr, dec_ptr.get(), text_len);
+		ASSERT_LE(space, 8 * comp_len);
+		spaces.push_back(space);
+		times.push_back(time);
+	}
+	ASSERT_LE(times[0], times[1]);
+	ASSERT_LE(times[1], times[2]);
+	ASSERT_GE(spaces[0], spaces[1]);
+	ASSERT_GE(spaces[1], spaces[2]);
+
+	// Within an absolute bound, up to the weight of the two phrases around the swap point
+	double time;
+	auto compressed = bczip::compress_bounded(
+		enc_name.c_str(), tm, bczip::compression_bound::time(times[1]),
+		text_ptr, text_len, nullptr, nullptr, &time
+	);
+	auto heaviest = tm.get_cost(tm.get_id(tm.get_dst().back(), tm.get_len().back()));
+	ASSERT_LE(time, times[1] + 2 * heaviest);
+}
+
+/**
+ * Decoding throughput of every encoder on the input file, best of a few
+ * rounds of decompress_buffer() calls, each lasting at least 50 ms.
+ */
+void decode_throughput()
+{
+	using namespace std::chrono;
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	std::vector<std::string> names;
+	encoders_().get_names(names);
+	for (auto &enc_name : names) {
+		size_t comp_len;
+		auto compressed = bczip::compress_buffer(enc_name.c_str(), text_ptr, text_len, &comp_len);
+		std::vector<byte> enlarged(bczip::safe_buffer_size(enc_name.c_str(), comp_len), 0U);
+		std::copy(compressed.get(), compressed.get() + comp_len, enlarged.begin());
+		std::vector<byte> output(bczip::safe_buffer_size(enc_name.c_str(), text_len));
+
+		double best = 0.0;
+		for (unsigned int round = 0; round < 3; round++) {
+			size_t runs = 0;
+			auto start = steady_clock::now();
+			duration<double> elapsed;
+			do {
+				bczip::decompress_buffer(enc_name.c_str(), enlarged.data(), output.data(), text_len);
+				++runs;
+				elapsed = steady_clock::now() - start;
+			} while (elapsed < milliseconds(50));
+			best = std::max(best, runs * text_len / elapsed.count() / 1e6);
+		}
+		check_equal(text_ptr, output.data(), text_len);
+		std::cout << enc_name << ":\t" << best << " MB/s (" << comp_len << " bytes)" << std::endl;
+	}
+}
+
+/** The prefetching decoder of every encoder decompresses the input file */
+void prefetch_decode()
+{
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	std::vector<std::string> names;
+	encoders_().get_names(names);
+	for (auto &enc_name : names) {
+		size_t comp_len;
+		auto compressed = bczip::compress_buffer(enc_name.c_str(), text_ptr, text_len, &comp_len);
+		std::vector<byte> enlarged(bczip::safe_buffer_size(enc_name.c_str(), comp_len), 0U);
+		std::copy(compressed.get(), compressed.get() + comp_len, enlarged.begin());
+		std::vector<byte> output(bczip::safe_buffer_size(enc_name.c_str(), text_len));
+		decompress_raw<fast_copy, prefetch_lookahead>(enc_name.c_str(), enlarged.data(), output.data(), text_len);
+		check_equal(text_ptr, output.data(), text_len);
+	}
+}
+
+/** Every encoder decompresses the input file in place, within its margin */
+void in_place_decode()
+{
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	std::vector<std::string> names;
+	encoders_().get_names(names);
+	for (auto &enc_name : names) {
+		size_t comp_len;
+		auto compressed = bczip::compress(enc_name.c_str(), text_ptr, text_len, &comp_len);
+		std::istringstream in(std::string(reinterpret_cast<char*>(compressed.get()), comp_len));
+		for (bool prefetch : {false, true}) {
+			in.seekg(0);
+			auto dec_res = decompress_in_place(in, comp_len, prefetch);
+			ASSERT_EQ(dec_res.uncompressed_size, text_len);
+			check_equal(text_ptr, dec_res.rep.get(), text_len);
+		}
+	}
+}
+
+/** Checksums appended to a compressed file come back with the text, and tell a damaged block */
+void checksum_decode()
+{
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	size_t comp_len;
+	auto compressed = bczip::compress(config::encoder.c_str(), text_ptr, text_len, &comp_len);
+	compressed_file file = {std::move(compressed), comp_len, 0U};
+	auto checksums = checksum_blocks(text_ptr, text_len, 4096U);
+	add_checksums(file, checksums);
+
+	std::istringstream in(std::string(reinterpret_cast<char*>(file.data.get()), file.total_size));
+	auto dec_res = decompress_in_place(in, file.total_size);
+	check_equal(text_ptr, dec_res.rep.get(), text_len);
+	ASSERT_EQ(dec_res.checksums.block_size, 4096U);
+	ASSERT_EQ(dec_res.checksums.sums, checksums.sums);
+	ASSERT_EQ(first_mismatch(dec_res.checksums, dec_res.rep.get(), text_len), checksums.sums.size());
+	dec_res.rep[text_len - 1] ^= 1U;
+	ASSERT_EQ(first_mismatch(dec_res.checksums, dec_res.rep.get(), text_len), checksums.sums.size() - 1);
+}
+
+/** Prefixes of every length class, ending within phrases or not, are decoded exactly */
+void prefix_decode()
+{
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	std::vector<std::string> names;
+	encoders_().get_names(names);
+	for (auto &enc_name : names) {
+		auto compressed = bczip::compress(enc_name.c_str(), text_ptr, text_len);
+		for (size_t prefix : {size_t(0), size_t(1), size_t(7), size_t(100), size_t(4097), text_len / 3, text_len, text_len + 10}) {
+			// The canary after the prefix must stay untouched
+			std::vector<byte> output(std::min(prefix, text_len) + 1, 0xA5);
+			auto decoded = bczip::decompress_prefix(compressed.get(), output.data(), prefix);
+			ASSERT_EQ(decoded, std::min(prefix, text_len));
+			check_equal(text_ptr, output.data(), decoded);
+			ASSERT_EQ(output.back(), 0xA5);
+		}
+	}
+}
+
+/** Files of the first format, without the magic and the header fields added since, still decode */
+void legacy_decode()
+{
+	auto text_ptr = config::data.get();
+	auto text_len = config::data_len;
+	size_t comp_len;
+	auto compressed = bczip::compress(config::encoder.c_str(), text_ptr, text_len, &comp_len);
+	ASSERT_TRUE(versioned(compressed.get()));
+	std::string enc_name;
+	size_t orig_len;
+	byte *parsing;
+	std::tie(enc_name, orig_len, parsing) = unpack(compressed.get());
+	size_t parsing_len = comp_len - (parsing - compressed.get());
+
+	// Encoder name, uncompressed length, parsing
+	std::vector<byte> legacy(enc_name.begin(), enc_name.end());
+	legacy.push_back('\0');
+	uncomp_size_t len_field = orig_len;
+	auto len_bytes = reinterpret_cast<byte*>(&len_field);
+	legacy.insert(legacy.end(), len_bytes, len_bytes + sizeof(len_field));
+	legacy.insert(legacy.end(), parsing, parsing + parsing_len);
+	size_t legacy_len = legacy.size();
+	legacy.resize(legacy_len + unaligned_io::bit_reader::padding, 0U);
+
+	ASSERT_FALSE(versioned(legacy.data()));
+	ASSERT_EQ(in_place_margin(legacy.data()), 0U);
+	ASSERT_EQ(checksum_block(legacy.data()), 0U);
+	ASSERT_THROW(set_in_place_margin(legacy.data(), 1U), std::logic_error);
+	auto full = decompress_full(legacy.data());
+	ASSERT_EQ(full.enc_name, enc_name);
+	ASSERT_EQ(full.uncompressed_size, text_len);
+	check_equal(text_ptr, full.rep.get(), text_len);
+	std::istringstream in(std::string(reinterpret_cast<char*>(legacy.data()), legacy_len));
+	auto in_place = decompress_in_place(in, legacy_len);
+	ASSERT_EQ(in_place.uncompressed_size, text_len);
+	check_equal(text_ptr, in_place.rep.get(), text_len);
+
+	// Versions from the future are rejected
+	compressed[sizeof(format_magic)] = format_version + 1;
+	ASSERT_THROW(unpack(compressed.get()), std::runtime_error);
+}
+
 TEST(raw_compress, all)
 {
 	raw_compress_test();
@@ -220,6 +438,41 @@ TEST(fix_parsing, all)
 	fix_parsing();
 }
 
+TEST(compress_bounded, all)
+{
+	compress_bounded_test();
+}
+
+TEST(decompress_raw, prefetch)
+{
+	prefetch_decode();
+}
+
+TEST(decompress_in_place, all)
+{
+	in_place_decode();
+}
+
+TEST(decompress_prefix, all)
+{
+	prefix_decode();
+}
+
+TEST(decompress_in_place, checksums)
+{
+	checksum_decode();
+}
+
+TEST(format, legacy)
+{
+	legacy_decode();
+}
+
+TEST(decompress_buffer, throughput)
+{
+	decode_throughput();
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   if (argc < 2) {
@@ -18,15 +18,22 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <limits>
 
 #include <stdint.h>
 #include <assert.h>
 #include <stdint.h>
 #include <string.h>
 #include <common.hpp>
+#include <checksum.hpp>
 #include <cost_model.hpp>
 #include <copy_routines.hpp>
 #include <encoders.hpp>
+#include <format.hpp>
+#include <huffman.hpp>
 #include <gtest/gtest.h>
 
 template <typename dst_desc>
@@ -131,12 +138,13 @@ void writer_test()
 	ASSERT_EQ(exp_word, 0xFEDCBA98U);
 }
 
+template <typename reader_t>
 void reader_test()
 {
 	// Write something with the writer
 	const size_t byte_size = 1024U;
-	byte data[byte_size];
-	std::fill(data, data + byte_size, 0U);
+	byte data[byte_size + unaligned_io::bit_reader::padding];
+	std::fill(data, data + byte_size + unaligned_io::bit_reader::padding, 0U);
 	unaligned_io::writer writer(data);
 	unsigned int write = 0U;
 	byte *data_ptr = data;
@@ -160,7 +168,7 @@ void reader_test()
 
 	// Read the same of what we read, with matching operations
 	write = 0U;
-	unaligned_io::reader reader(data);
+	reader_t reader(data);
 	for (unsigned int i = 0; i < byte_size / 4U; i++) {
 		byte read = 0U;
 		reader.read(read, 4);
@@ -173,7 +181,7 @@ void reader_test()
 //	std::cout << std::endl;
 
 	// Read the same of what we read, but this time reading blocks of 16-bit word with offsets.
-	reader = unaligned_io::reader(data);
+	reader = reader_t(data);
 	byte read = 0U;
 	reader.read(read, 4);
 	ASSERT_EQ(read, 0U);
@@ -187,7 +195,7 @@ void reader_test()
 	}
 
 	// The same, but with peek().
-	reader = unaligned_io::reader(data);
+	reader = reader_t(data);
 	read = 0U;
 	reader.peek(read, 4);
 	reader.skip_bits(4);
@@ -203,7 +211,7 @@ void reader_test()
 	}
 
 	// Get three-bits and assemble'em
-	reader = unaligned_io::reader(data);
+	reader = reader_t(data);
 	read = 0U;
 	reader.peek(read, 4);
 	reader.skip_bits(4);
@@ -387,10 +395,23 @@ void soda09_test()
 		}
 	}
 
-	// Encode some numbers
+	// Encode some numbers, then mix numbers and strings: the decoder reads
+	// ahead, so the whole stream is written before decoding it
+	byte run[10];
+	std::string test_string_1 = "test";
+	std::string test_string_2 = "pluto";
 	{
 		enc.encode(42U, 64U);
 		enc.encode(64U, 128U);
+		std::copy(test_string_1.begin(), test_string_1.end(), run);
+		enc.encode(run, test_string_1.size(), 2U);
+		enc.encode(1 << 20, 1 << 10);
+		enc.encode(1 << 10, 1 << 20);
+		std::copy(test_string_2.begin(), test_string_2.end(), run);
+		enc.encode(run, test_string_2.size(), 2U);
+	}
+
+	{
 		std::uint32_t dst, len;
 		dec.decode(dst, len);
 		ASSERT_EQ(dst, 42U);
@@ -400,24 +421,13 @@ void soda09_test()
 		ASSERT_EQ(len, 128U);
 	}
 
-	// Mix numbers and strings
 	{
-		byte data[10];
-		std::string test_string_1 = "test";
-		std::copy(test_string_1.begin(), test_string_1.end(), data);
-		enc.encode(data, test_string_1.size(), 2U);
-		enc.encode(1 << 20, 1 << 10);
-		enc.encode(1 << 10, 1 << 20);
-		std::string test_string_2 = "pluto";
-		std::copy(test_string_2.begin(), test_string_2.end(), data);
-		enc.encode(data, test_string_2.size(), 2U);
-		//======
 		std::uint32_t dst, len, next;
-		dec.decode(data, len, next);
+		dec.decode(run, len, next);
 		ASSERT_EQ(len, test_string_1.size());
 		ASSERT_EQ(next, 2U);
 		for (auto i = 0U; i < len; i++) {
-			ASSERT_EQ(test_string_1[i], data[i]);
+			ASSERT_EQ(test_string_1[i], run[i]);
 		}
 		dec.decode(dst, len);
 		ASSERT_EQ(dst, 1 << 20);
@@ -425,11 +435,11 @@ void soda09_test()
 		dec.decode(dst, len);
 		ASSERT_EQ(len, 1 << 20);
 		ASSERT_EQ(dst, 1 << 10);
-		dec.decode(data, len, next);
+		dec.decode(run, len, next);
 		ASSERT_EQ(len, test_string_2.size());
 		ASSERT_EQ(next, 2U);
 		for (auto i = 0U; i < len; i++) {
-			ASSERT_EQ(test_string_2[i], data[i]);
+			ASSERT_EQ(test_string_2[i], run[i]);
 		}
 	}
 }
@@ -475,7 +485,11 @@ TEST(unaligned_io, writer) {
 }
 
 TEST(unaligned_io, reader) {
-	reader_test();
+	reader_test<unaligned_io::reader>();
+}
+
+TEST(unaligned_io, bit_reader) {
+	reader_test<unaligned_io::bit_reader>();
 }
 
 TEST(gamma_like, SODA09_DST) {
@@ -534,6 +548,259 @@ TEST(literal_writer, 1U) {
 	literal_test<std::uint16_t, 1U>();	
 }
 
+template <typename run_t>
+void split_test()
+{
+	typedef lzopt::split::encoder<run_t> encoder;
+	typedef lzopt::split::decoder<run_t> decoder;
+
+	// Costs are those of hybrid
+	auto cm = encoder::get_cm(), hybrid_cm = lzopt::hybrid::encoder<lzopt::literal_write<run_t>>::get_cm();
+	ASSERT_EQ(cm.get_dst(), hybrid_cm.get_dst());
+	ASSERT_EQ(cm.get_len(), hybrid_cm.get_len());
+	ASSERT_EQ(cm.lit_cost(3U), hybrid_cm.lit_cost(3U));
+
+	std::string run_1 = "test", run_2 = "pluto";
+	// Literal runs, 4 bytes each; distances and lengths, 4 + 2 and 1 + 1 bytes
+	size_t bits = (run_1.size() + run_2.size()) * 8 + 2 * (cm.lit_cost(0U)) + (4 + 2 + 1 + 1) * 8;
+	std::vector<byte> data(encoder::data_len(bits) + decoder::extra_read(), 0U);
+	{
+		encoder enc(data.data(), encoder::data_len(bits));
+		enc.encode(reinterpret_cast<byte*>(&run_1[0]), run_1.size(), 2U);
+		enc.encode(1 << 29, 1 << 10);
+		enc.encode(42U, 64U);
+		enc.encode(reinterpret_cast<byte*>(&run_2[0]), run_2.size(), 1U);
+	}
+	// Stream sizes come first
+	std::uint32_t sizes[3];
+	std::memcpy(sizes, data.data(), sizeof(sizes));
+	ASSERT_EQ(sizes[0], 2 * (sizeof(run_t) + sizeof(std::uint32_t)));
+	ASSERT_EQ(sizes[1], run_1.size() + run_2.size());
+	ASSERT_EQ(sizes[2], 3U);
+
+	decoder dec(data.data(), run_1.size() + run_2.size() + (1 << 10) + 64);
+	std::uint32_t dst, len, next;
+	// Room for the longest run, plus what the decoder may write past it
+	std::vector<byte> out(std::numeric_limits<run_t>::max() + 1U + in_place_slack);
+	dec.decode(out.data(), len, next);
+	ASSERT_EQ(std::string(out.data(), out.data() + len), run_1);
+	ASSERT_EQ(next, 2U);
+	dec.decode(dst, len);
+	ASSERT_EQ(dst, 1U << 29);
+	ASSERT_EQ(len, 1U << 10);
+	dec.decode(dst, len);
+	ASSERT_EQ(dst, 42U);
+	ASSERT_EQ(len, 64U);
+	dec.decode(out.data(), len, next);
+	ASSERT_EQ(std::string(out.data(), out.data() + len), run_2);
+	ASSERT_EQ(next, 1U);
+}
+
+TEST(split, 8) {
+	split_test<std::uint8_t>();
+}
+
+TEST(split, 16) {
+	split_test<std::uint16_t>();
+}
+
+TEST(huffman, lengths) {
+	// Fibonacci frequencies make a Huffman code as deep as possible
+	std::array<size_t, 256> freqs;
+	freqs.fill(0U);
+	size_t a = 1, b = 1;
+	for (unsigned int c = 0; c < 30; c++) {
+		freqs[c] = a;
+		std::tie(a, b) = std::make_tuple(b, a + b);
+	}
+	auto lengths = huffman::build_lengths(freqs);
+	double kraft = 0;
+	for (unsigned int c = 0; c < 256; c++) {
+		ASSERT_EQ(lengths[c] > 0, freqs[c] > 0);
+		ASSERT_LE(lengths[c], huffman::max_code_len);
+		kraft += lengths[c] > 0 ? std::ldexp(1.0, -lengths[c]) : 0.0;
+	}
+	ASSERT_LE(kraft, 1.0);
+}
+
+TEST(huffman, round_trip) {
+	// Skewed blocks, a single-symbol one and an incompressible one
+	std::vector<byte> text;
+	std::uint32_t seed = 42;
+	auto next_rand = [&]() {
+		seed = seed * 1103515245U + 12345U;
+		return seed >> 16;
+	};
+	for (size_t i = 0; i < 2 * huffman::block_size + 1000; i++) {
+		auto r = next_rand();
+		text.push_back('a' + __builtin_ctz(r | (1U << 20)));
+	}
+	text.insert(text.end(), huffman::block_size, 'z');
+	for (size_t i = 0; i < huffman::block_size; i++) {
+		text.push_back(next_rand());
+	}
+	std::vector<byte> coded;
+	huffman::encode(text.data(), text.size(), coded);
+	ASSERT_LE(coded.size(), huffman::max_encoded_len(text.size()));
+	ASSERT_LT(coded.size(), text.size() * 3 / 4);
+	ASSERT_LT(huffman::symbol_cost(text.data(), 2 * huffman::block_size), 3.0);
+	coded.resize(coded.size() + huffman::padding);
+
+	std::vector<byte> decoded(text.size());
+	huffman::block_reader reader(coded.data());
+	for (size_t i = 0, run = 1; i < text.size(); run = run * 7 % 1000 + 1) {
+		run = std::min(run, text.size() - i);
+		reader.read(decoded.data() + i, run);
+		i += run;
+	}
+	ASSERT_EQ(decoded, text);
+}
+
+TEST(split, huffman) {
+	typedef lzopt::split_huff_coder_16::encoder encoder;
+	typedef lzopt::split_huff_coder_16::decoder decoder;
+	std::string text;
+	for (unsigned int i = 0; text.size() < 100000; i++) {
+		text += "the quick brown fox jumps over the lazy dog " + std::to_string(i % 97) + "\n";
+	}
+	auto text_ptr = reinterpret_cast<byte*>(&text[0]);
+	// Literals cost less than 8 bits on text
+	auto cm = encoder::get_cm(text_ptr, text.size());
+	ASSERT_LT(cm.lit_cost(1000U), encoder::get_cm().lit_cost(1000U));
+
+	// Literal runs of 1000 bytes, then a phrase
+	const unsigned int run = 1000U;
+	size_t phrases = text.size() / run, bits = 0;
+	auto static_cm = encoder::get_cm();
+	for (size_t i = 0; i < phrases; i++) {
+		bits += static_cm.lit_cost(run) + static_cm.edge_cost(static_cm.get_edge(run, 4U));
+	}
+	std::vector<byte> data(encoder::data_len(bits), 0U);
+	size_t written;
+	{
+		encoder enc(data.data(), data.size());
+		for (size_t i = 0; i < phrases; i++) {
+			enc.encode(text_ptr + i * run, run, 1U);
+			enc.encode(run, 4U);
+		}
+		written = enc.flush();
+	}
+	ASSERT_LT(written, phrases * run * 3 / 4);
+
+	decoder dec(data.data(), phrases * (run + 4));
+	std::vector<byte> out(run + 16);
+	for (size_t i = 0; i < phrases; i++) {
+		std::uint32_t dst, len, next;
+		dec.decode(out.data(), len, next);
+		ASSERT_EQ(len, run);
+		ASSERT_EQ(next, 1U);
+		ASSERT_TRUE(std::equal(out.begin(), out.begin() + run, text_ptr + i * run));
+		dec.decode(dst, len);
+		ASSERT_EQ(dst, run);
+		ASSERT_EQ(len, 4U);
+	}
+}
+
+void check_classes(const std::vector<unsigned int> &bounds)
+{
+	class_finder finder(bounds);
+	auto check = [&](unsigned int x) {
+		auto expected = std::distance(bounds.begin(), std::lower_bound(bounds.begin(), bounds.end(), x));
+		ASSERT_EQ(finder.find(x, bounds), expected) << "Value: " << x;
+	};
+	for (unsigned int x = 0; x < (1U << 16); x++) {
+		check(x);
+	}
+	for (unsigned int k = 0; k < 32; k++) {
+		check(1U << k);
+		check((1U << k) - 1);
+		check((1U << k) + 1);
+	}
+	for (auto b : bounds) {
+		check(b - 1);
+		check(b);
+		check(b + 1);
+	}
+}
+
+TEST(rep, round_trip) {
+	typedef lzopt::rep_coder_16::encoder encoder;
+	typedef lzopt::rep_coder_16::decoder decoder;
+	// Repeats of the last and previous distances, and plain distances in every class
+	std::vector<std::uint32_t> dsts = {100U, 100U, 7U, 100U, 7U, 7U, 61U, 62U, 63U, 16382U, 16383U, 4194302U, 4194303U, 62U, 4194303U};
+	std::vector<byte> data(dsts.size() * 8 + 16, 0U);
+	size_t written;
+	{
+		encoder enc(data.data(), data.size());
+		for (size_t i = 0; i < dsts.size(); i++) {
+			enc.encode(dsts[i], 4U + i);
+		}
+		written = enc.written();
+	}
+	// A repeated distance takes a byte
+	ASSERT_LT(written, dsts.size() * 6);
+	decoder dec(data.data(), 0U);
+	for (size_t i = 0; i < dsts.size(); i++) {
+		std::uint32_t dst, len;
+		dec.decode(dst, len);
+		ASSERT_EQ(dst, dsts[i]);
+		ASSERT_EQ(len, 4U + i);
+	}
+
+	auto cm = encoder::get_cm();
+	ASSERT_TRUE(cm.has_rep());
+	rep_distances reps;
+	reps.push(100000U);
+	auto edge = cm.get_edge(100000U, 4U);
+	ASSERT_LT(cm.edge_cost(edge, reps), cm.edge_cost(edge));
+	ASSERT_EQ(cm.edge_cost(edge, reps), 16U);
+}
+
+TEST(cost_model, class_finder) {
+	std::vector<unsigned int> dst(ITERS(nibble::class_desc::cost_classes)), len(ITERS(soda09::soda09_len::cost_classes));
+	check_classes(dst);
+	check_classes(len);
+	// Bounds of fused cost models
+	std::vector<unsigned int> fused(dst);
+	fused.insert(fused.end(), ITERS(soda09::soda09_dst::cost_classes));
+	std::sort(ITERS(fused));
+	check_classes(fused);
+	// Buckets with more bounds than the tables hold
+	std::vector<unsigned int> dense;
+	for (unsigned int b = 1; b < 1500; b += 7) {
+		dense.push_back(b);
+	}
+	dense.push_back(std::numeric_limits<unsigned int>::max());
+	check_classes(dense);
+	// Too many classes for the tables
+	for (unsigned int b = 1500; b < 5000; b += 7) {
+		dense.insert(std::prev(dense.end()), b);
+	}
+	check_classes(dense);
+}
+
+TEST(checksum, crc32c) {
+	const std::string check = "123456789";
+	ASSERT_EQ(crc32c(reinterpret_cast<const byte*>(check.data()), check.size()), 0xE3069283U);
+	ASSERT_EQ(crc32c(nullptr, 0), 0U);
+	// Blocks hashed three at a time, and a shorter last one
+	std::vector<byte> text(10 * 1000 + 17);
+	std::uint32_t seed = 7;
+	for (auto &c : text) {
+		seed = seed * 1103515245U + 12345U;
+		c = seed >> 16;
+	}
+	auto checksums = checksum_blocks(text.data(), text.size(), 1000U);
+	ASSERT_EQ(checksums.sums.size(), 11U);
+	for (size_t i = 0; i < checksums.sums.size(); i++) {
+		auto start = i * 1000U;
+		ASSERT_EQ(checksums.sums[i], crc32c(text.data() + start, std::min<size_t>(1000U, text.size() - start)));
+	}
+	ASSERT_EQ(first_mismatch(checksums, text.data(), text.size()), checksums.sums.size());
+	text[4321] ^= 0x10;
+	ASSERT_EQ(first_mismatch(checksums, text.data(), text.size()), 4U);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -88,18 +88,15 @@ sa_cacher solution_integrator_test::sc;
 size_t solution_integrator_test::lit_len;
 char *solution_integrator_test::encoder_name;
 
-void check_eq(std::vector<edge_t> &got, std::vector<edge_t> &expected)
+void check_eq(const phrase_list &got, const phrase_list &expected)
 {
 	ASSERT_EQ(got.size(), expected.size());
-	auto len = got.size() - 1;
-	auto i = 0U;
-	while (i < len) {
+	for (auto i = 0U; i < got.size(); i++) {
 		auto &integrated = got[i];
 		auto &fully_generated = expected[i];
 		ASSERT_EQ(integrated.d, fully_generated.d);
 		ASSERT_EQ(integrated.ell, fully_generated.ell);
 		ASSERT_EQ(integrated.cost_id, fully_generated.cost_id);	
-		i += integrated.ell;
 	}
 }
 
@@ -146,9 +143,10 @@ TEST_F(solution_integrator_test, check)
 		vector_in(&cache_cost, data_ptr),
 		vector_in(&cache_weight, data_ptr)
 	};
+	phrase_list fixed_cost, fixed_weight;
 	std::vector<vector_out> out = {
-		vector_out(&cache_cost, data_ptr, data_ptr + ti.len, cm),
-		vector_out(&cache_weight, data_ptr, data_ptr + ti.len, cm),
+		vector_out(&fixed_cost, data_ptr, data_ptr + ti.len, cm),
+		vector_out(&fixed_weight, data_ptr, data_ptr + ti.len, cm),
 	};
 	t1 = std::chrono::high_resolution_clock::now();		
 	si.integrate(in, out);
@@ -156,13 +154,13 @@ TEST_F(solution_integrator_test, check)
 	std::cout << "elapsed time: " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << std::endl;
 
 	// Check both if they are equal
-	check_eq(cache_cost, real_cost);
-	check_eq(cache_weight, real_weight);
+	check_eq(fixed_cost, real_cost);
+	check_eq(fixed_weight, real_weight);
 }
 
 class compressor {
 public:
-	virtual compressed_file compress(const std::vector<edge_t> &solution, text_info ti) = 0;
+	virtual compressed_file compress(const phrase_list &solution, text_info ti) = 0;
 };
 
 template <typename enc_>
@@ -176,9 +174,9 @@ public:
 
 	}
 
-	compressed_file compress(const std::vector<edge_t> &solution, text_info ti)
+	compressed_file compress(const phrase_list &solution, text_info ti)
 	{
-		auto p_length = parsing_length<size_t>(ITERS(solution), cm);
+		auto p_length = parsing_length<size_t>(solution, cm);
 		return write_parsing<enc_>(solution, p_length, ti);
 	}
 };
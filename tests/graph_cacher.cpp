@@ -14,15 +14,38 @@
  * limitations under the License.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <memory>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <tuple>
 #include <vector>
+#include <unistd.h>
 
+#include <api.hpp>
+#include <bicriteria_compressor.hpp>
+#include <bucket_fsg.hpp>
+#include <cm_factory.hpp>
+#include <encoders.hpp>
 #include <graph_cache.hpp>
+#include <parallel_parser.hpp>
+#include <solution_getter.hpp>
+#include <solution_integrator.hpp>
 #include <gtest/gtest.h>
 #include <wm_serializer.hpp>
 #include <fsg_check.hpp>
+#include <compact_rsa.hpp>
+#include <online_rsa.hpp>
+#include <match_integrator.hpp>
+#include <wavelet_matrix.hpp>
 
 template <typename cost_class_t, typename unary_type_t>
 void test_encoder(size_t v_size, double max_expansion)
@@ -56,6 +79,9 @@ void test_encoder(size_t v_size, double max_expansion)
 	unary_gammalike::decoder<cost_class_t, unary_type_t> dec(storage.data(), max_storage * 8);
 	for (auto i : to_check) {
 		enc.encode(i);
+	}
+	// The decoder reads ahead: it replays a complete stream
+	for (auto i : to_check) {
 		auto to_verify = dec.decode();
 		ASSERT_EQ(to_verify, i);
 	}
@@ -76,6 +102,35 @@ TEST(Encoder, nibble)
 	test_encoder<nibble::class_desc, byte>(1000000, 12.0 / 9);
 }
 
+TEST(Encoder, group_varint)
+{
+	// Mix of widths, and a count that leaves the last group incomplete
+	const size_t v_size = 1000003;
+	std::random_device rd;
+	std::uniform_int_distribution<unsigned int> width(0, 3), dist;
+	std::vector<unsigned int> to_check(v_size);
+	for (auto &i : to_check) {
+		auto w = width(rd);
+		i = w == 3 ? dist(rd) : dist(rd) & ((1U << (8 * w)) - 1U);
+	}
+	to_check[0] = 0;
+	to_check[1] = 255;
+	to_check[2] = 65536;
+	to_check[3] = std::numeric_limits<std::uint32_t>::max();
+
+	auto max_storage = static_cast<size_t>(std::ceil(group_varint::encoder::ub_gamma() * v_size)) + group_varint::max_group_bytes;
+	std::vector<byte> storage(max_storage, 0U);
+	group_varint::encoder enc(storage.data(), max_storage * 8);
+	for (auto i : to_check) {
+		enc.encode(i);
+	}
+	enc.flush();
+	group_varint::decoder dec(storage.data(), max_storage * 8);
+	for (auto i : to_check) {
+		ASSERT_EQ(dec.decode(), i);
+	}
+}
+
 /**
  * Start "cached_graph" implementation. Safe to move and copy around.
  */
@@ -144,6 +199,434 @@ TEST_F(graph_cache_test, Cached)
 	test_cached<unary_gammalike::decoder<nibble::class_desc, byte>>(graph_cache_test::ti, graph_cache_test::cm, graph_cache_test::cg, graph_cache_test::sc);
 }
 
+/** A fresh directory for spill files, under $TMPDIR or /tmp */
+std::string temp_dir()
+{
+	auto base = std::getenv("TMPDIR");
+	std::string path = std::string(base != nullptr ? base : "/tmp") + "/bczip-test-XXXXXX";
+	std::vector<char> tmpl(path.begin(), path.end());
+	tmpl.push_back('\0');
+	if (mkdtemp(tmpl.data()) == nullptr) {
+		throw std::runtime_error("Unable to create a temporary directory");
+	}
+	return tmpl.data();
+}
+
+TEST_F(graph_cache_test, Spilled)
+{
+	auto dir = temp_dir();
+	// Small chunks, to spill many times during the caching pass
+	cached_graph spilled(dir, 4096U);
+	test_caching<unary_gammalike::encoder<nibble::class_desc, byte>>(graph_cache_test::ti, graph_cache_test::cm, &spilled, graph_cache_test::sc);
+	ASSERT_TRUE(spilled.file_backed());
+	test_cached<unary_gammalike::decoder<nibble::class_desc, byte>>(graph_cache_test::ti, graph_cache_test::cm, spilled, graph_cache_test::sc);
+	// Same content of the in-memory graph
+	auto &cg = graph_cache_test::cg;
+	ASSERT_EQ(cg.allocated_size(), spilled.allocated_size());
+	ASSERT_TRUE(std::equal(cg.get_data(), cg.get_data() + cg.allocated_size(), spilled.get_data()));
+	// The file is gone with the descriptor
+	ASSERT_THROW(spilled.set(4096U, 1U), std::logic_error);
+	ASSERT_EQ(rmdir(dir.c_str()), 0);
+}
+
+TEST_F(graph_cache_test, GroupVarint)
+{
+	typedef group_varint::encoder encoder_t;
+	typedef group_varint::decoder decoder_t;
+	cached_graph in_memory;
+	test_caching<encoder_t>(graph_cache_test::ti, graph_cache_test::cm, &in_memory, graph_cache_test::sc);
+	test_cached<decoder_t>(graph_cache_test::ti, graph_cache_test::cm, in_memory, graph_cache_test::sc);
+	auto dir = temp_dir();
+	cached_graph spilled(dir, 4096U);
+	test_caching<encoder_t>(graph_cache_test::ti, graph_cache_test::cm, &spilled, graph_cache_test::sc);
+	test_cached<decoder_t>(graph_cache_test::ti, graph_cache_test::cm, spilled, graph_cache_test::sc);
+	ASSERT_EQ(rmdir(dir.c_str()), 0);
+}
+
+/** With a weight model (w_cm not empty), parses are bicriteria ones */
+template <typename decoder_t>
+void test_parallel(text_info ti, cost_model cm, cost_model w_cm, cached_graph cg, sa_cacher &sc, size_t segments, size_t threads)
+{
+	const size_t lit_win = 32U;
+	const bool bi = !w_cm.get_dst().empty();
+	graph_cuts<decoder_t> cuts(cg, cm, ti.len, segments);
+	ASSERT_TRUE(cuts.fits(cm));
+	// The parallel parser rounds the costs to the grid
+	auto grid_cm = on_grid(cm), grid_w_cm = bi ? on_grid(w_cm) : w_cm;
+	auto seq_parse = [&](double *cost, parse_arena *arena) {
+		auto fsg = cached_fsg_fact<decoder_t>(ti, sc, cg).instantiate(grid_cm);
+		return bi
+			? bi_optimal_parse(ti, std::move(*fsg.get()), lit_win, grid_cm, grid_w_cm, cost, empty_observer(), arena)
+			: parse(ti, std::move(*fsg.get()), lit_win, grid_cm, cost, empty_observer(), arena);
+	};
+	auto par_parse = [&](double *cost, parse_arena *arena) {
+		return bi
+			? parallel_bi_optimal_parse(ti, cuts, threads, lit_win, cm, w_cm, cost, empty_observer(), arena)
+			: parallel_parse(ti, cuts, threads, lit_win, cm, cost, empty_observer(), arena);
+	};
+	double seq_cost, par_cost;
+	auto seq_sol = seq_parse(&seq_cost, nullptr);
+	auto par_sol = par_parse(&par_cost, nullptr);
+
+	// Same parsing of the sequential parser
+	ASSERT_EQ(seq_cost, par_cost);
+	ASSERT_EQ(seq_sol.size(), par_sol.size());
+	for (auto i = 0U; i < seq_sol.size(); i++) {
+		ASSERT_EQ(seq_sol[i].d, par_sol[i].d) << "Position: " << i;
+		ASSERT_EQ(seq_sol[i].ell, par_sol[i].ell) << "Position: " << i;
+		ASSERT_EQ(seq_sol[i].cost_id, par_sol[i].cost_id) << "Position: " << i;
+	}
+	// Buffers from an arena, reused by the following parse, give the same parsing
+	parse_arena arena;
+	for (auto run = 0U; run < 2U; run++) {
+		double arena_cost;
+		auto arena_sol = run == 0U ? seq_parse(&arena_cost, &arena) : par_parse(&arena_cost, &arena);
+		ASSERT_EQ(arena_cost, par_cost);
+		ASSERT_EQ(arena_sol.size(), par_sol.size());
+		for (auto i = 0U; i < arena_sol.size(); i++) {
+			ASSERT_EQ(arena_sol[i].d, par_sol[i].d) << "Position: " << i;
+			ASSERT_EQ(arena_sol[i].ell, par_sol[i].ell) << "Position: " << i;
+		}
+		arena.recycle(std::move(arena_sol));
+	}
+	// Same lengths and distance classes when found on the suffix array, even
+	// for prefixes of maximal edges and rep matches (with actual distances)
+	phrase_list matched_sol;
+	std::unique_ptr<byte[]> out(new byte[ti.len]);
+	std::vector<vector_in> m_ins{vector_in(&par_sol, ti.text.get())};
+	std::vector<vector_out> m_outs{vector_out(&matched_sol, out.get(), out.get() + ti.len, cm)};
+	match_integrator(ti, sc, cm).integrate(m_ins, m_outs);
+	ASSERT_TRUE(check_correctness(matched_sol, ti.text.get()).correct);
+	ASSERT_EQ(matched_sol.size(), par_sol.size());
+	auto dsts = cm.get_dst();
+	auto dst_class = [&](std::uint32_t d) {
+		return std::distance(dsts.begin(), std::lower_bound(dsts.begin(), dsts.end(), d));
+	};
+	size_t pos = 0U;
+	for (auto i = 0U; i < matched_sol.size(); i++) {
+		auto &in = par_sol[i], &matched = matched_sol[i];
+		ASSERT_EQ(matched.ell, in.ell) << "Phrase: " << i;
+		if (in.kind() == PLAIN) {
+			ASSERT_EQ(matched.kind(), PLAIN) << "Phrase: " << i;
+		} else {
+			ASSERT_EQ(dst_class(matched.d), dst_class(in.d)) << "Phrase: " << i;
+			auto src = ti.text.get() + pos - in.d;
+			if (in.d <= pos && std::equal(src, src + in.ell, ti.text.get() + pos)) {
+				// Actual distances are kept
+				ASSERT_EQ(matched.d, in.d) << "Phrase: " << i;
+			}
+		}
+		pos += in.ell;
+	}
+	if (cm.has_rep()) {
+		// Rep matches are not maximal edges, which solution_integrator fixes
+		return;
+	}
+	// Cached edges only carry the distance class: recover the actual distances
+	phrase_list fixed_sol;
+	std::vector<vector_in> ins{vector_in(&par_sol, ti.text.get())};
+	std::vector<vector_out> outs{vector_out(&fixed_sol, out.get(), out.get() + ti.len, cm)};
+	solution_integrator<empty_observer, fsg_fact>(fsg_fact(ti, sc), cm).integrate(ins, outs);
+	ASSERT_TRUE(check_correctness(fixed_sol, ti.text.get()).correct);
+	ASSERT_EQ(matched_sol.size(), fixed_sol.size());
+	for (auto i = 0U; i < matched_sol.size(); i++) {
+		ASSERT_EQ(matched_sol[i].ell, fixed_sol[i].ell) << "Phrase: " << i;
+		ASSERT_EQ(matched_sol[i].cost_id, fixed_sol[i].cost_id) << "Phrase: " << i;
+	}
+}
+
+/** A model with the classes of cm and fractional costs, as time models have */
+cost_model fractional_model(const cost_model &cm)
+{
+	auto costs = cm.get_cm();
+	for (auto i = 0U; i < costs.dsts(); i++) {
+		for (auto j = 0U; j < costs.lens(); j++) {
+			costs(i, j) = 1.0 / 3.0 + 0.7071 * (i + 1) + 0.0137 * j;
+		}
+	}
+	return cost_model(cm.get_dst(), cm.get_len(), costs, 0.4142, 0.1732);
+}
+
+/** Cheaper copies at recent distances, one cost per length class */
+cost_model with_rep(cost_model cm, double scale)
+{
+	std::vector<double> reps;
+	for (auto len : cm.get_len()) {
+		reps.push_back(scale * std::log2(len + 1.0));
+	}
+	cm.set_rep_costs(reps);
+	return cm;
+}
+
+TEST_F(graph_cache_test, ParallelParse)
+{
+	typedef unary_gammalike::decoder<nibble::class_desc, byte> decoder_t;
+	auto &cm = graph_cache_test::cm;
+	auto time_cm = fractional_model(cm);
+	// Bicriteria models, as those of the dual search
+	auto bi_cm = cm_factory(cm, time_cm).lambda(0.6180339887);
+	std::vector<std::tuple<cost_model, cost_model>> models{
+		std::make_tuple(cm, cost_model()),
+		std::make_tuple(bi_cm, time_cm),
+		std::make_tuple(with_rep(cm, 1.0), cost_model()),
+		std::make_tuple(with_rep(bi_cm, 0.8660254), with_rep(time_cm, 0.3090170))
+	};
+	// Integer costs are on the grid already: the same parsing of the sequential parser on cm
+	auto grid_cm = on_grid(cm);
+	ASSERT_EQ(grid_cm.lit_cost(0), cm.lit_cost(0));
+	ASSERT_EQ(grid_cm.lit_cost(1), cm.lit_cost(1));
+	for (auto i = 0U; i < cm.get_dst().size(); i++) {
+		for (auto j = 0U; j < cm.get_len().size(); j++) {
+			ASSERT_EQ(grid_cm.get_cost(i, j), cm.get_cost(i, j));
+		}
+	}
+	ASSERT_NE(on_grid(time_cm).get_cost(0U, 0U), time_cm.get_cost(0U, 0U));
+	for (auto &models_pair : models) {
+		// Many segments force speculative (non-cut) boundaries as well, and
+		// more segments than workers are speculated in turn
+		for (auto segments : {1U, 2U, 4U, 7U, 64U}) {
+			for (auto threads : {1U, 3U}) {
+				test_parallel<decoder_t>(graph_cache_test::ti, std::get<0>(models_pair), std::get<1>(models_pair), graph_cache_test::cg, graph_cache_test::sc, segments, threads);
+			}
+		}
+	}
+}
+
+/** Bucketed parse of ti with the generators of gen_fact (window = 0 for no history) */
+template <typename gen_fact>
+phrase_list bucket_parse(text_info ti, cost_model cm, size_t bucket_size, size_t window, double *cost, size_t in_flight = 1U)
+{
+	sa_instantiate sa;
+	bucket_fsg<gen_fact> fsg(ti, sa, bucket_size, cm, window, in_flight);
+	return parse(ti, fsg, 32U, cm, cost, empty_observer());
+}
+
+template <typename gen_fact>
+void test_buckets(text_info ti, cost_model cm)
+{
+	const size_t bucket_size = ti.len / 7 + 1;
+	double no_history, with_history;
+	auto base_sol = bucket_parse<gen_fact>(ti, cm, bucket_size, 0U, &no_history);
+	ASSERT_TRUE(check_correctness(base_sol, ti.text.get()).correct);
+	auto sol = bucket_parse<gen_fact>(ti, cm, bucket_size, std::min<size_t>(bucket_size, cm.get_dst().back()), &with_history);
+	ASSERT_TRUE(check_correctness(sol, ti.text.get()).correct);
+	// The edges of buckets without history are also edges with history
+	ASSERT_LE(with_history, no_history);
+	// Buckets built on the parsing thread, or many at once ahead of it, give the same parsing
+	for (size_t in_flight : {0U, 3U}) {
+		double cost;
+		auto other = bucket_parse<gen_fact>(ti, cm, bucket_size, std::min<size_t>(bucket_size, cm.get_dst().back()), &cost, in_flight);
+		ASSERT_EQ(cost, with_history) << "In flight: " << in_flight;
+		ASSERT_EQ(other.size(), sol.size()) << "In flight: " << in_flight;
+		for (auto i = 0U; i < sol.size(); i++) {
+			ASSERT_EQ(other[i].d, sol[i].d) << "In flight: " << in_flight << ", phrase: " << i;
+			ASSERT_EQ(other[i].ell, sol[i].ell) << "In flight: " << in_flight << ", phrase: " << i;
+		}
+	}
+}
+
+TEST_F(graph_cache_test, Buckets)
+{
+	test_buckets<ffsg_fact>(graph_cache_test::ti, graph_cache_test::cm);
+	test_buckets<fsg_fact>(graph_cache_test::ti, graph_cache_test::cm);
+}
+
+/**
+ * Fills a compact block and a plain one with the same entries (positions
+ * from start on, increasing ranks) and checks they are read back the same
+ */
+void compare_rsa_blocks(size_t capacity, size_t universe, unsigned int start, const std::vector<std::uint32_t> &ranks, std::mt19937 &gen)
+{
+	typedef compact_rsa<std::int32_t> compact_t;
+	typedef rsa<std::tuple<std::int32_t, std::int32_t>> plain_t;
+	std::vector<compact_t::unit_type> c_storage(compact_t::units(capacity, universe));
+	std::vector<plain_t::unit_type> p_storage(plain_t::units(capacity, universe));
+	auto compact = compact_t::make(c_storage.begin(), 1U, capacity, universe);
+	auto plain = plain_t::make(p_storage.begin(), 1U, capacity, universe);
+	std::vector<std::int32_t> positions(ranks.size());
+	std::iota(positions.begin(), positions.end(), start);
+	std::shuffle(positions.begin(), positions.end(), gen);
+	// Blocks are reused: fill them twice
+	for (auto round = 0U; round < 2U; round++) {
+		compact.set_start(start);
+		compact.resize(ranks.size());
+		plain.set_start(start);
+		plain.resize(ranks.size());
+		for (size_t i = 0; i < ranks.size(); i++) {
+			auto entry = std::make_tuple(positions[i], static_cast<std::int32_t>(ranks[i]));
+			compact.set(i, entry);
+			plain.set(i, entry);
+		}
+		ASSERT_EQ(compact.size(), plain.size());
+		ASSERT_EQ(compact.start(), plain.start());
+		ASSERT_EQ(compact.term(), plain.term());
+		ASSERT_EQ(compact.level(), plain.level());
+		ASSERT_TRUE(std::equal(compact.begin(), compact.end(), plain.begin()));
+		ASSERT_EQ(std::distance(compact.begin(), compact.end()), static_cast<std::ptrdiff_t>(ranks.size()));
+		std::reverse(positions.begin(), positions.end());
+	}
+}
+
+TEST(CompactRsa, SameOfPlain)
+{
+	std::mt19937 gen(42);
+	// Empty blocks
+	compact_rsa<std::int32_t> empty;
+	ASSERT_EQ(empty.size(), 0U);
+	ASSERT_TRUE(empty.begin() == empty.end());
+	compare_rsa_blocks(16U, 1000U, 5U, {}, gen);
+	for (size_t universe : {1U, 2U, 100U, 65536U, 1U << 30}) {
+		for (size_t capacity : {1U, 2U, 3U, 64U, 1000U}) {
+			if (capacity > universe) {
+				continue;
+			}
+			// Boundary ranks: the first ones, the last ones, both
+			std::vector<std::uint32_t> first(capacity), last(capacity);
+			std::iota(first.begin(), first.end(), 0U);
+			std::iota(last.begin(), last.end(), universe - capacity);
+			compare_rsa_blocks(capacity, universe, 0U, first, gen);
+			compare_rsa_blocks(capacity, universe, 7U, last, gen);
+			std::vector<std::uint32_t> ends{0U};
+			if (capacity > 1U) {
+				ends.push_back(universe - 1);
+			}
+			compare_rsa_blocks(capacity, universe, 3U, ends, gen);
+			// Random blocks, full or not
+			for (auto run = 0U; run < 20U; run++) {
+				std::uniform_int_distribution<size_t> size_dist(0U, capacity);
+				std::uniform_int_distribution<std::uint32_t> rank_dist(0U, universe - 1);
+				std::set<std::uint32_t> ranks;
+				for (auto size = size_dist(gen); ranks.size() < size;) {
+					ranks.insert(rank_dist(gen));
+				}
+				compare_rsa_blocks(capacity, universe, rank_dist(gen), std::vector<std::uint32_t>(ranks.begin(), ranks.end()), gen);
+			}
+		}
+	}
+}
+
+TEST(WaveletMatrix, RangeQueries)
+{
+	std::mt19937 gen(42);
+	for (std::uint32_t max : {0U, 1U, 100U, 1U << 20, std::numeric_limits<std::uint32_t>::max()}) {
+		std::uniform_int_distribution<std::uint32_t> dist(0, max);
+		// A length that is a multiple of 64 exercises the padding word
+		std::vector<std::uint32_t> values(1024);
+		for (auto &v : values) {
+			v = dist(gen);
+		}
+		wavelet_matrix wm(values);
+		ASSERT_EQ(wm.size(), values.size());
+		std::uniform_int_distribution<size_t> pos(0, values.size());
+		for (auto q = 0U; q < 2000U; q++) {
+			auto a = pos(gen), b = pos(gen);
+			std::uint64_t x = q % 8U == 0 ? max : dist(gen);
+			std::uint64_t next = wavelet_matrix::npos, prev = wavelet_matrix::npos;
+			for (auto i = a; i < b; i++) {
+				if (values[i] >= x && (next == wavelet_matrix::npos || values[i] < next)) {
+					next = values[i];
+				}
+				if (values[i] < x && (prev == wavelet_matrix::npos || values[i] > prev)) {
+					prev = values[i];
+				}
+			}
+			ASSERT_EQ(wm.next_value(a, b, x), next) << a << ", " << b << ", " << x;
+			ASSERT_EQ(wm.prev_value(a, b, x), prev) << a << ", " << b << ", " << x;
+			if (a < values.size()) {
+				ASSERT_EQ(wm.access(a), values[a]);
+			}
+		}
+		ASSERT_EQ(wm.prev_value(0, values.size(), std::uint64_t(max) + 1), *std::max_element(values.begin(), values.end()));
+	}
+}
+
+/**
+ * Runs a bicriteria compression of the text within limits, with the model
+ * as time model, and returns its log
+ */
+std::string bicriteria_log(text_info ti, cost_model time_cm, search_limits limits)
+{
+	typedef nibble4_coder_1 enc_t;
+	typedef solution_getter<empty_observer, gen_ffsg_fact, unary_codec> sol_getter_t;
+	auto space_cm = encoders_().get_cm(enc_t::name(), ti.text.get(), ti.len);
+	sol_getter_t sg(ti, enc_t::encoder::get_literal_len());
+	bicriteria_compressor<enc_t, sol_getter_t> compressor(ti, sg, space_cm, time_cm, 3U, limits);
+	std::ostringstream log;
+	compressor.set_log(&log);
+	size_t space;
+	// Checks the parsing, whatever the limits
+	compressor.run(std::make_shared<relative_bound>(SPACE, 0.5), true, &space);
+	return log.str();
+}
+
+/** Iterations of the search in a log of bicriteria_log */
+size_t iterations(const std::string &log)
+{
+	const std::string prefix = "λ = ";
+	std::istringstream lines(log);
+	size_t count = 0;
+	for (std::string line; std::getline(lines, line); ) {
+		count += line.compare(0, prefix.size(), prefix) == 0;
+	}
+	return count;
+}
+
+TEST_F(graph_cache_test, SearchLimits)
+{
+	// Copies are slower the farther they go: a trade-off with space
+	auto time_cm = fractional_model(cm);
+	search_limits limits;
+	auto log = bicriteria_log(ti, time_cm, limits);
+	auto converged = iterations(log);
+	ASSERT_GT(converged, 1U);
+	ASSERT_EQ(log.find("Deadline reached"), std::string::npos);
+	// A gap any iteration closes: a single one
+	limits.tolerance = 1e300;
+	ASSERT_EQ(iterations(bicriteria_log(ti, time_cm, limits)), 1U);
+	// A deadline past the end of the search: the same search
+	limits.tolerance = search_limits().tolerance;
+	limits.deadline = std::chrono::hours(1);
+	ASSERT_EQ(iterations(bicriteria_log(ti, time_cm, limits)), converged);
+	// A deadline gone once the basis is initialized: no iteration, the basis is still integrated
+	limits.deadline = std::chrono::milliseconds(1);
+	log = bicriteria_log(ti, time_cm, limits);
+	ASSERT_EQ(iterations(log), 0U);
+	ASSERT_NE(log.find("Deadline reached"), std::string::npos);
+	ASSERT_NE(log.find("Integrating base"), std::string::npos);
+}
+
+TEST_F(graph_cache_test, RepWarmStart)
+{
+	// Base parsings are integrated on the suffix array (see match_integrator)
+	typedef lzopt::rep_coder_8 enc_t;
+	typedef solution_getter<empty_observer, gen_ffsg_fact, unary_codec> sol_getter_t;
+	auto space_cm = encoders_().get_cm(enc_t::name(), ti.text.get(), ti.len);
+	ASSERT_TRUE(space_cm.has_rep());
+	auto time_cm = fractional_model(space_cm);
+	auto dir = temp_dir();
+	auto path = dir + "/lambdas";
+	std::vector<size_t> spaces;
+	for (auto run = 0U; run < 2U; run++) {
+		sol_getter_t sg(ti, enc_t::encoder::get_literal_len());
+		bicriteria_compressor<enc_t, sol_getter_t> compressor(ti, sg, space_cm, time_cm);
+		std::ostringstream log;
+		compressor.set_log(&log);
+		compressor.use_warm_start(std::make_shared<warm_start_file>(path), "test");
+		size_t space;
+		auto compressed = compressor.run(std::make_shared<relative_bound>(SPACE, 0.5), true, &space);
+		// The second run starts from the basis of the first one
+		ASSERT_EQ(log.str().find("Warm start") != std::string::npos, run == 1U);
+		size_t dec_len;
+		auto dec = bczip::decompress(compressed.data.get(), &dec_len);
+		ASSERT_EQ(dec_len, ti.len);
+		ASSERT_TRUE(std::equal(ti.text.get(), ti.text.get() + ti.len, dec.get()));
+		spaces.push_back(space);
+	}
+	ASSERT_EQ(spaces[0], spaces[1]);
+	ASSERT_EQ(std::remove(path.c_str()), 0);
+	ASSERT_EQ(rmdir(dir.c_str()), 0);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,306 @@
+/**
+ * Copyright 2014 Andrea Farruggia
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bicriteria_compressor.hpp>
+#include <encoders.hpp>
+#include <gtest/gtest.h>
+#include <memory_planner.hpp>
+#include <warm_start.hpp>
+
+TEST(parse_memory_size, suffixes)
+{
+	ASSERT_EQ(parse_memory_size("1000"), 1000U);
+	ASSERT_EQ(parse_memory_size("4K"), 4096U);
+	ASSERT_EQ(parse_memory_size("4k"), 4096U);
+	ASSERT_EQ(parse_memory_size("3M"), size_t(3) << 20);
+	ASSERT_EQ(parse_memory_size("2G"), size_t(2) << 30);
+	ASSERT_EQ(parse_memory_size("1.5G"), size_t(3) << 29);
+	ASSERT_EQ(parse_memory_size("1T"), size_t(1) << 40);
+}
+
+TEST(parse_memory_size, malformed)
+{
+	for (auto str : {"", "G", "abc", "10X", "10KB", "10 K", "-4M", "0", "0K", "nan", "inf", "1e400", "1e30T"}) {
+		ASSERT_THROW(parse_memory_size(str), std::runtime_error) << "Size: '" << str << "'";
+	}
+}
+
+class memory_planner_test : public ::testing::Test {
+protected:
+	static const size_t t_len = size_t(1) << 26;
+	memory_planner planner;
+
+	memory_planner_test() : planner(t_len, encoders_().get_cm("nibble4"))
+	{
+
+	}
+
+	/** The settings of plan_bicriteria, from the fastest to the leanest */
+	static std::vector<std::tuple<graph_encoding, bool, size_t>> settings()
+	{
+		return {
+			std::make_tuple(GROUP_VARINT_GRAPH, false, 3U),
+			std::make_tuple(UNARY_GRAPH, false, 3U),
+			std::make_tuple(UNARY_GRAPH, false, 1U),
+			std::make_tuple(UNARY_GRAPH, true, 3U),
+			std::make_tuple(UNARY_GRAPH, true, 1U)
+		};
+	}
+
+	size_t footprint(const std::tuple<graph_encoding, bool, size_t> &s, size_t threads = 1U)
+	{
+		return planner.bicriteria(std::get<0>(s), std::get<1>(s), std::get<2>(s), threads).total();
+	}
+};
+
+const size_t memory_planner_test::t_len;
+
+TEST_F(memory_planner_test, bicriteria_choices)
+{
+	auto all = settings();
+	for (size_t i = 1; i < all.size(); i++) {
+		ASSERT_GT(footprint(all[i - 1]), footprint(all[i])) << "Setting: " << i;
+	}
+	// A budget fitting exactly a setting picks it, but not one byte less
+	for (auto &s : all) {
+		auto budget = footprint(s);
+		auto plan = planner.plan_bicriteria(budget, true, 1U);
+		ASSERT_EQ(std::make_tuple(plan.encoding, plan.spill, plan.cache_capacity), s);
+		ASSERT_LE(plan.estimate.total(), budget);
+		if (&s != &all.back()) {
+			plan = planner.plan_bicriteria(budget - 1, true, 1U);
+			ASSERT_NE(std::make_tuple(plan.encoding, plan.spill, plan.cache_capacity), s);
+		}
+	}
+	ASSERT_THROW(planner.plan_bicriteria(footprint(all.back()) - 1, true, 1U), std::runtime_error);
+	// No spilling: the in-memory settings only
+	ASSERT_THROW(planner.plan_bicriteria(footprint(all[2]) - 1, false, 1U), std::runtime_error);
+	ASSERT_FALSE(planner.plan_bicriteria(footprint(all[2]), false, 1U).spill);
+	// The parallel parser needs more memory
+	ASSERT_GT(footprint(all[0], 4U), footprint(all[0]));
+	auto plan = planner.plan_bicriteria(footprint(all[0]), true, 4U);
+	ASSERT_NE(std::make_tuple(plan.encoding, plan.spill, plan.cache_capacity), all[0]);
+}
+
+TEST_F(memory_planner_test, buckets)
+{
+	const size_t granularity = 1U << 20;
+	ASSERT_EQ(planner.plan_bucket(planner.bucketed(0U).total(), granularity), 0U);
+	ASSERT_EQ(planner.plan_bucket(std::numeric_limits<size_t>::max(), granularity), 0U);
+	// Two buckets and their history windows are alive at once
+	for (auto fraction : {8U, 13U, 64U}) {
+		auto budget = planner.bucketed(t_len / fraction).total();
+		ASSERT_LT(budget, planner.bucketed(0U).total());
+		auto bucket = planner.plan_bucket(budget, granularity);
+		ASSERT_GT(bucket, 0U);
+		ASSERT_EQ(bucket % granularity, 0U);
+		ASSERT_LE(planner.bucketed(bucket).total(), budget);
+		ASSERT_GT(planner.bucketed(bucket + granularity).total(), budget);
+	}
+	ASSERT_THROW(planner.plan_bucket(planner.bucketed(granularity).total() - 1, granularity), std::runtime_error);
+}
+
+TEST(parse_duration, units)
+{
+	using std::chrono::milliseconds;
+	ASSERT_EQ(parse_duration("250ms"), milliseconds(250));
+	ASSERT_EQ(parse_duration("3"), milliseconds(3000));
+	ASSERT_EQ(parse_duration("3s"), milliseconds(3000));
+	ASSERT_EQ(parse_duration("1.5s"), milliseconds(1500));
+	ASSERT_EQ(parse_duration("2m"), milliseconds(120000));
+	ASSERT_EQ(parse_duration("1h"), milliseconds(3600000));
+	// Rounded up, never to zero
+	ASSERT_EQ(parse_duration("0.1ms"), milliseconds(1));
+	ASSERT_EQ(parse_duration("1.0001s"), milliseconds(1001));
+}
+
+TEST(parse_duration, malformed)
+{
+	for (auto str : {"", "s", "abc", "10x", "10 s", "10sec", "0", "0ms", "-1s", "nan"}) {
+		ASSERT_THROW(parse_duration(str), std::runtime_error) << "Duration: '" << str << "'";
+	}
+}
+
+TEST(search_limits, tolerance)
+{
+	search_limits limits;
+	ASSERT_FALSE(limits.converged(std::numeric_limits<double>::max()));
+	ASSERT_FALSE(limits.converged(2 * limits.tolerance));
+	ASSERT_TRUE(limits.converged(limits.tolerance));
+	ASSERT_TRUE(limits.converged(0.0));
+	limits.tolerance = 0.0;
+	ASSERT_FALSE(limits.converged(1e-300));
+	ASSERT_TRUE(limits.converged(0.0));
+}
+
+TEST(search_limits, deadline)
+{
+	typedef search_limits::clock clock;
+	using std::chrono::milliseconds;
+	search_limits limits;
+	auto start = clock::now();
+	// No deadline: never out of time
+	ASSERT_FALSE(limits.out_of_time(start, start + std::chrono::hours(24), std::chrono::hours(24)));
+	limits.deadline = milliseconds(100);
+	ASSERT_FALSE(limits.out_of_time(start, start, clock::duration(0)));
+	ASSERT_FALSE(limits.out_of_time(start, start + milliseconds(40), milliseconds(60)));
+	// Another iteration as long as the last one would end too late
+	ASSERT_TRUE(limits.out_of_time(start, start + milliseconds(40), milliseconds(61)));
+	ASSERT_TRUE(limits.out_of_time(start, start + milliseconds(101), clock::duration(0)));
+}
+
+/** A warm start file in a fresh directory under $TMPDIR or /tmp, removed with it */
+class warm_start_test : public ::testing::Test {
+protected:
+	std::string dir;
+	std::string path;
+
+	warm_start_test()
+	{
+		auto base = std::getenv("TMPDIR");
+		std::string tmpl = std::string(base != nullptr ? base : "/tmp") + "/bczip-test-XXXXXX";
+		std::vector<char> name(tmpl.begin(), tmpl.end());
+		name.push_back('\0');
+		if (mkdtemp(name.data()) == nullptr) {
+			throw std::runtime_error("Unable to create a temporary directory");
+		}
+		dir = name.data();
+		path = dir + "/lambdas";
+	}
+
+	~warm_start_test()
+	{
+		std::remove(path.c_str());
+		rmdir(dir.c_str());
+	}
+
+	static warm_start_entry entry(std::string bound, std::string encoder, std::string target, double lambda)
+	{
+		warm_start_entry e;
+		e.bound = bound;
+		e.encoder = encoder;
+		e.target = target;
+		e.lambda = lambda;
+		e.left_lambda = lambda / 3;
+		e.right_lambda = -1;
+		e.left_space = 12345;
+		e.left_time = 0.1;
+		e.right_space = 6789;
+		e.right_time = 1e-300;
+		return e;
+	}
+
+	static void assert_same(const warm_start_entry &e1, const warm_start_entry &e2)
+	{
+		ASSERT_EQ(e1.key(), e2.key());
+		// Read back exactly
+		ASSERT_EQ(e1.lambda, e2.lambda);
+		ASSERT_EQ(e1.left_lambda, e2.left_lambda);
+		ASSERT_EQ(e1.right_lambda, e2.right_lambda);
+		ASSERT_EQ(e1.left_space, e2.left_space);
+		ASSERT_EQ(e1.left_time, e2.left_time);
+		ASSERT_EQ(e1.right_space, e2.right_space);
+		ASSERT_EQ(e1.right_time, e2.right_time);
+	}
+};
+
+TEST_F(warm_start_test, round_trip)
+{
+	warm_start_entry found;
+	ASSERT_FALSE(warm_start_file(path).find("0.5S", "nibble4", "x86", &found));
+	auto e1 = entry("0.5S", "nibble4", "x86", 1.0 / 3), e2 = entry("0.5S", "nibble4", "arm", 0.1);
+	{
+		warm_start_file file(path);
+		file.store(e1);
+		file.store(e2);
+		// Replaced, not added
+		e1.lambda = 2.0 / 7;
+		file.store(e1);
+	}
+	warm_start_file file(path);
+	ASSERT_TRUE(file.find("0.5S", "nibble4", "x86", &found));
+	assert_same(found, e1);
+	ASSERT_TRUE(file.find("0.5S", "nibble4", "arm", &found));
+	assert_same(found, e2);
+	ASSERT_FALSE(file.find("0.5T", "nibble4", "x86", &found));
+	ASSERT_FALSE(file.find("0.5S", "soda09_16", "x86", &found));
+	std::ifstream in(path);
+	ASSERT_EQ(std::count(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(), '\n'), 3);
+}
+
+TEST_F(warm_start_test, malformed_lines)
+{
+	{
+		std::ofstream out(path);
+		out << "# a comment\n"
+			<< "\n"
+			<< "0.5S\tnibble4\tx86\t0.25\t0.125\t-1\t100\t2\t50\t4\n"
+			<< "0.5S\tnibble4\tarm\t0.25\t0.125\n"
+			<< "0.5S\tnibble4\tmips\tnot_a_number\t0.125\t-1\t100\t2\t50\t4\n"
+			<< "\tnibble4\tsparc\t0.25\t0.125\t-1\t100\t2\t50\t4\n"
+			<< "garbage\n"
+			<< "0.5T\tnibble4\tx86\t0.75\t0.5\t-1\t100\t2\t50\t4";
+	}
+	warm_start_file file(path);
+	warm_start_entry found;
+	ASSERT_TRUE(file.find("0.5S", "nibble4", "x86", &found));
+	ASSERT_EQ(found.lambda, 0.25);
+	ASSERT_EQ(found.right_time, 4);
+	// The last line needs no newline
+	ASSERT_TRUE(file.find("0.5T", "nibble4", "x86", &found));
+	ASSERT_EQ(found.lambda, 0.75);
+	for (auto target : {"arm", "mips", "sparc"}) {
+		ASSERT_FALSE(file.find("0.5S", "nibble4", target, &found)) << "Target: " << target;
+	}
+	// Saving drops them
+	file.store(entry("0.5S", "nibble4", "arm", 0.5));
+	std::ifstream in(path);
+	ASSERT_EQ(std::count(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(), '\n'), 4);
+}
+
+TEST_F(warm_start_test, atomic_store)
+{
+	auto e = entry("0.5S", "nibble4", "x86", 0.25);
+	warm_start_file file(path);
+	file.store(e);
+	// Nothing left aside
+	struct stat st;
+	ASSERT_NE(stat((path + ".tmp").c_str(), &st), 0);
+	// When the new file cannot be written, the old one stays as it is
+	ASSERT_EQ(mkdir((path + ".tmp").c_str(), 0700), 0);
+	auto changed = e;
+	changed.lambda = 0.5;
+	ASSERT_THROW(file.store(changed), std::runtime_error);
+	ASSERT_EQ(rmdir((path + ".tmp").c_str()), 0);
+	warm_start_entry found;
+	ASSERT_TRUE(warm_start_file(path).find("0.5S", "nibble4", "x86", &found));
+	assert_same(found, e);
+}
@@ -50,8 +50,8 @@ protected:
 		auto fsg_gen = fsg_fact(ti, sc).instantiate(cm);
 		double cost;
 		optimal_sol = parse(ti, *fsg_gen.get(), lit_len, cm, &cost, empty_observer());
-		optimal_cost = parsing_length<double>(ITERS(optimal_sol), cm);
-		optimal_weight = parsing_length<double>(ITERS(optimal_sol), w_cm);		
+		optimal_cost = parsing_length<double>(optimal_sol, cm);
+		optimal_weight = parsing_length<double>(optimal_sol, w_cm);		
 	}
 
 public:
@@ -61,7 +61,7 @@ public:
 	static cost_model w_cm;
 	static sa_cacher sc;
 	static char *encoder_name;
-	static std::vector<edge_t> optimal_sol;
+	static phrase_list optimal_sol;
 	static double optimal_cost;
 	static double optimal_weight;
 
@@ -92,7 +92,7 @@ cached_graph solution_getter_test::cg;
 cost_model solution_getter_test::cm;
 cost_model solution_getter_test::w_cm;
 sa_cacher solution_getter_test::sc;
-std::vector<edge_t> solution_getter_test::optimal_sol;
+phrase_list solution_getter_test::optimal_sol;
 size_t solution_getter_test::lit_len;
 double solution_getter_test::optimal_cost;
 double solution_getter_test::optimal_weight;
@@ -103,7 +103,7 @@ TEST_F(solution_getter_test, optimal_full_fsg)
 	auto sol = sg.full(cm);
 
 	// Get costs and certify they are indeed equal
-	auto cost = parsing_length<double>(ITERS(sol), cm);
+	auto cost = parsing_length<double>(sol, cm);
 	ASSERT_EQ(cost, optimal_cost);
 }
 
@@ -134,26 +134,26 @@ TEST_F(solution_getter_test, optimal_full_fast)
 	auto sol = sg.fast(cm);
 
 	// Make sure its cost is OK
-	auto cost_opt = parsing_length<double>(ITERS(sol), cm);
+	auto cost_opt = parsing_length<double>(sol, cm);
 	ASSERT_EQ(cost_opt, optimal_cost);
 }
 
 double get_weight_lower_bound(size_t t_len, size_t lit_len, cost_model w_cm)
 {
-	std::vector<edge_t> dummy_sol(t_len);
-	for (auto i = 0u; i < dummy_sol.size();) {
-		auto max_lit_len = std::min<unsigned int>(dummy_sol.size(), lit_len);
-		dummy_sol[i] = edge_t(max_lit_len);
+	phrase_list dummy_sol;
+	for (auto i = 0u; i < t_len;) {
+		auto max_lit_len = std::min<unsigned int>(t_len - i, lit_len);
+		dummy_sol.push_back(edge_t(max_lit_len));
 		i += max_lit_len;
 	}
-	return parsing_length<double>(ITERS(dummy_sol), w_cm);
+	return parsing_length<double>(dummy_sol, w_cm);
 }
 
 TEST_F(solution_getter_test, weight_optimal)
 {
 	// Get a weight-optimal solution
 	auto sol = sg.full(w_cm);
-	auto weight = parsing_length<double>(ITERS(sol), w_cm);
+	auto weight = parsing_length<double>(sol, w_cm);
 
 	// Obtain an upper-bound on solution's weight: literal cost
 	auto m_weight = get_weight_lower_bound(ti.len, lit_len, w_cm);
@@ -168,8 +168,8 @@ TEST_F(solution_getter_test, bi_optimal_full)
 	auto sol = sg.full(cm, w_cm);
 
 	// Get cost and weight
-	auto cost = parsing_length<double>(ITERS(sol), cm);
-	auto weight = parsing_length<double>(ITERS(sol), w_cm);
+	auto cost = parsing_length<double>(sol, cm);
+	auto weight = parsing_length<double>(sol, w_cm);
 
 	ASSERT_EQ(cost, optimal_cost);
 	ASSERT_LE(weight, optimal_weight);
@@ -194,12 +194,12 @@ TEST_F(solution_getter_test, bi_full_fast)
 	std::cout << std::endl << "Elapsed time: " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << std::endl;
 	std::cout << "Estimating parsing costs... ";
 	t1 = std::chrono::high_resolution_clock::now();
-	auto full_cost = parsing_length<double>(ITERS(full_sol), cm);
-	auto full_weight = parsing_length<double>(ITERS(full_sol), w_cm);
+	auto full_cost = parsing_length<double>(full_sol, cm);
+	auto full_weight = parsing_length<double>(full_sol, w_cm);
 	ASSERT_TRUE(sg.warm());
-	auto fast_cost = parsing_length<double>(ITERS(fast_sol), cm);
+	auto fast_cost = parsing_length<double>(fast_sol, cm);
 	ASSERT_TRUE(sg.warm());
-	auto fast_weight = parsing_length<double>(ITERS(fast_sol), w_cm);
+	auto fast_weight = parsing_length<double>(fast_sol, w_cm);
 	t2 = std::chrono::high_resolution_clock::now();
 	std::cout << "time: " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << std::endl;
 	ASSERT_EQ(fast_cost, full_cost);
@@ -340,6 +340,16 @@ struct empty_copy {
 	}
 };
 
+/** Decompression time of a parsing, with the prefetching decoder if prefetch */
+template <typename copy_>
+std::uint64_t decode_time(bool prefetch, const char *encoder, byte *parsing, byte *output, size_t orig_size)
+{
+	if (prefetch) {
+		return decompress_raw<copy_, prefetch_lookahead>(encoder, parsing, output, orig_size);
+	}
+	return decompress_raw<copy_>(encoder, parsing, output, orig_size);
+}
+
 struct time_matrix {
 	cost_matrix cm;
 	std::vector<unsigned int> dsts;
@@ -431,7 +441,7 @@ void reduce_tm(time_matrix *tm)
 	(tm->cm).set(cm);
 }
 
-time_matrix phrase_decode_time(const char *encoder)
+time_matrix phrase_decode_time(const char *encoder, bool prefetch)
 {
 
 	using namespace std::chrono;
@@ -490,7 +500,7 @@ time_matrix phrase_decode_time(const char *encoder)
 
 			// STEP 3: invoke decompression, passing an empty copier, and measure the time
 			// byte first;
-			auto elapsed = 1.0 * decompress_raw<empty_copy>(encoder, p_parsing, literal_buffer, orig_size);
+			auto elapsed = 1.0 * decode_time<empty_copy>(prefetch, encoder, p_parsing, literal_buffer, orig_size);
 
 			// STEP 4: divide time by number of phrases, and get the individual phrase time
 			elapsed /= dummy_phrases;
@@ -561,7 +571,7 @@ void write_parsing(std::string encoder_name, size_t orig_len, size_t comp_len, b
 	write_file<byte>(file, pack_info.parsing.get(), pack_info.data_len);
 }
 
-std::uint64_t get_dec_time(std::string encoder, byte *parsing, byte *dest, size_t orig_len, size_t comp_len)
+std::uint64_t get_dec_time(std::string encoder, byte *parsing, byte *dest, size_t orig_len, size_t comp_len, bool prefetch)
 {
 	// Get a temporary file
 	char tmp_file[] = "./parsing-XXXXXX";
@@ -573,14 +583,18 @@ std::uint64_t get_dec_time(std::string encoder, byte *parsing, byte *dest, size_
 	write_parsing(encoder, orig_len, comp_len, parsing, tmp_file);
 
 	// Decompress it
-	const int argc = 4;
-	const char *argv[] = {"", "", tmp_file, "/dev/null"};
-	char *m_argv[argc];
+	const int argc = prefetch ? 5 : 4;
+	const char *argv[] = {"", "", tmp_file, "/dev/null", "--prefetch"};
+	char *m_argv[5];
 
-	std::vector<char> string_storage(argc + std::strlen(argv[2]) + std::strlen(argv[3]));
+	size_t storage_len = 0;
+	for (auto i = 0; i < argc; i++) {
+		storage_len += std::strlen(argv[i]) + 1;
+	}
+	std::vector<char> string_storage(storage_len);
 	auto storage_ptr = string_storage.data();
 
-	for (auto i = 0U; i < argc; i++) {
+	for (auto i = 0; i < argc; i++) {
 		m_argv[i] = storage_ptr;
 		storage_ptr = std::copy(argv[i], argv[i] + std::strlen(argv[i]), storage_ptr);
 		*storage_ptr++ = '\0';
@@ -599,6 +613,36 @@ std::uint64_t get_dec_time(std::string encoder, byte *parsing, byte *dest, size_
 	return to_ret;
 }
 
+/**
+ * Returns len bytes distributed like text: the printable characters,
+ * ordered as in English, with Zipf-like frequencies. Literal decoders
+ * that entropy-code their input (e.g. split-huff) decode a buffer of
+ * zeros far faster than real literals.
+ */
+std::vector<byte> text_like_literals(size_t len)
+{
+	const std::string by_frequency =
+		" etaoinshrdlcumwfgypbvkjxqz\nETAOINSHRDLCUMWFGYPBVKJXQZ.,'\"-;:!?()0123456789";
+	std::vector<double> weights;
+	for (auto i = 0U; i < by_frequency.size(); i++) {
+		weights.push_back(1.0 / (i + 1));
+	}
+	// A fixed seed keeps calibrations comparable; a 1MiB pattern, repeated,
+	// is enough since literals are never matched
+	std::mt19937 gen(42U);
+	std::discrete_distribution<unsigned int> dist(weights.begin(), weights.end());
+	std::vector<byte> pattern(std::min<size_t>(len, 1U << 20));
+	for (auto &c : pattern) {
+		c = static_cast<byte>(by_frequency[dist(gen)]);
+	}
+	std::vector<byte> literals(len);
+	for (size_t i = 0; i < len; i += pattern.size()) {
+		auto chunk = std::min(pattern.size(), len - i);
+		std::copy(pattern.begin(), pattern.begin() + chunk, literals.begin() + i);
+	}
+	return literals;
+}
+
 /**
  * @brief Returns the couple (fixed time, variable time) of encoder's literal time cost.
  * @param encoder
@@ -606,7 +650,7 @@ std::uint64_t get_dec_time(std::string encoder, byte *parsing, byte *dest, size_
  * @return
  *		The couple (fixed time, variable time)
  */
-std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder)
+std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder, bool prefetch)
 {
 	// First: get encoder's literal max length
 	const size_t min_lit = 4;
@@ -616,7 +660,7 @@ std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder)
 	const size_t l_1 = min_lit * l_2;
 	const size_t min_lit_len = one_gig / l_1;
 
-	std::vector<byte> literal_buffer(one_gig);
+	auto literal_buffer = text_like_literals(one_gig);
 
 	std::cerr << "Max literal length = " << max_lit_len << std::endl;
 
@@ -626,7 +670,7 @@ std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder)
 							end = uniform_literal_it::end(one_gig);
 		auto dummy_parsing = get_parsing(encoder, begin, end, literal_buffer.data());
 		print_stats(dummy_parsing.parsing.get(), one_gig, encoder);
-		auto t = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size);
+		auto t = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size, prefetch);
 		// t = decompress_raw(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), sixteen_mega);
 		std::cerr << "T = " << std::fixed << t << " nsec (" << std::fixed << t / 1000000 << " msec)" << std::endl;
 		return std::make_tuple(nanosecs_t(max_lit_len * t / one_gig), nanosecs_t(0));
@@ -639,7 +683,7 @@ std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder)
 							end = uniform_literal_it::end(one_gig);
 		auto dummy_parsing = get_parsing(encoder, begin, end, literal_buffer.data());
 		print_stats(dummy_parsing.parsing.get(), one_gig, encoder);
-		t_1 = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size);
+		t_1 = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size, prefetch);
 		// t_1 = decompress_raw(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), sixteen_mega);
 		std::cerr << "T_1 = " << std::fixed << t_1 << " nsec (" << std::fixed << t_1 / 1000000 << " msec)" << std::endl;
 	}
@@ -656,7 +700,7 @@ std::tuple<nanosecs_t, nanosecs_t> literal_decode_time(const char *encoder)
 		auto dummy_parsing = get_parsing(encoder, begin, end, literal_buffer.data());
 		// TODO: Anche qui
 		print_stats(dummy_parsing.parsing.get(), one_gig, encoder);
-		t_2 = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size);
+		t_2 = get_dec_time(encoder, dummy_parsing.parsing.get(), literal_buffer.data(), one_gig, dummy_parsing.size, prefetch);
 		std::cerr << "T_2 = " << std::fixed << t_2 << " nsec (" << std::fixed << t_2 / 1000000 << " msec)" << std::endl;
 	}
 
@@ -735,7 +779,7 @@ nanosecs_t bmp_bench(size_t copy_length, nanosecs_t copy_time)
 	return (thousand_copies - est_time - empty_thousand_copies) / copies_no;
 }
 
-nanosecs_t lit_pen_time(const char *encoder, nanosecs_t phrase_decode, nanosecs_t lit_fix)
+nanosecs_t lit_pen_time(const char *encoder, nanosecs_t phrase_decode, nanosecs_t lit_fix, bool prefetch)
 {
 	// Generate a parsing with a mix of 80% phrases and 20% literals
 	const size_t length = 5 * std::mega::num;
@@ -754,11 +798,11 @@ nanosecs_t lit_pen_time(const char *encoder, nanosecs_t phrase_decode, nanosecs_
 			literals++;
 		}
 	}
-	std::vector<byte> lit_buf(length, 0);
+	auto lit_buf = text_like_literals(length);
 	auto p_t = get_parsing(encoder, ITERS(dummy_parsing), lit_buf.data());
 
 	auto t1 = std::chrono::high_resolution_clock::now();
-	decompress_raw<empty_copy>(encoder, p_t.parsing.get(), lit_buf.data(), length);
+	decode_time<empty_copy>(prefetch, encoder, p_t.parsing.get(), lit_buf.data(), length);
 	auto t2 = std::chrono::high_resolution_clock::now();
 	auto spent_time = std::chrono::duration_cast<nanosecs_t>(t2 - t1);
 
@@ -770,6 +814,52 @@ nanosecs_t lit_pen_time(const char *encoder, nanosecs_t phrase_decode, nanosecs_
 	return (spent_time - exp_time) / length;
 }
 
+/**
+ * Share of the memory latency that the copies of the prefetching decoder
+ * still pay: copies from random positions of a large buffer are decoded by
+ * both decoders, net of the time of the same copies from nearby.
+ */
+double exposed_latency(const char *encoder)
+{
+	const size_t buffer_len = 64 * std::mega::num;
+	const size_t near_dst = 4 * std::kilo::num;
+	cost_model cm = encoders_().get_cm(encoder);
+	size_t max_dst = cm.get_dst().back();
+	std::random_device rd;
+	std::mt19937 gen(rd());
+	std::uniform_int_distribution<unsigned int> len_gen(8, 16);
+	byte literal_buffer[] = {'a', 'a', 'a', 'a', 'a', 'a', 'a', 'a'};
+	std::vector<byte> output(buffer_len + 16, 0);
+
+	auto copies_time = [&] (bool far) {
+		std::vector<edge_t> edges;
+		edges.push_back(edge_t(1));
+		size_t pos = 1;
+		while (pos + 16 < buffer_len) {
+			auto len = len_gen(gen);
+			size_t limit = std::min(far ? pos : std::min(pos, near_dst), max_dst);
+			std::uniform_int_distribution<size_t> dst_gen(1, limit);
+			edges.push_back(cm.get_edge(dst_gen(gen), len));
+			pos += len;
+		}
+		auto p_t = get_parsing(encoder, ITERS(edges), literal_buffer);
+		double plain = decode_time<fast_copy>(false, encoder, p_t.parsing.get(), output.data(), pos);
+		double ahead = decode_time<fast_copy>(true, encoder, p_t.parsing.get(), output.data(), pos);
+		return std::make_tuple(plain, ahead);
+	};
+
+	double far_plain, far_ahead, near_plain, near_ahead;
+	std::tie(far_plain, far_ahead) = copies_time(true);
+	std::tie(near_plain, near_ahead) = copies_time(false);
+	std::cerr << "Far copies: " << far_plain << " nsec, " << far_ahead << " nsec prefetching" << std::endl;
+	std::cerr << "Near copies: " << near_plain << " nsec, " << near_ahead << " nsec prefetching" << std::endl;
+	if (far_plain <= near_plain) {
+		return 1.0;
+	}
+	auto factor = (far_ahead - near_ahead) / (far_plain - near_plain);
+	return std::min(1.0, std::max(0.0, factor));
+}
+
 cost_model get_cm(
 		std::vector<std::tuple<unsigned int, nanosecs_t>> latencies, nanosecs_t copy_time,
 		time_matrix phrase_times,
@@ -901,6 +991,16 @@ int main(int argc, char **argv)
 	using std::tuple;
 	using std::vector;
 
+	// Calibrates the prefetching decoder (see decompress) if asked to
+	bool prefetch = false;
+	auto last_arg = std::remove_if(argv + 1, argv + argc, [] (char *arg) {
+		return std::strcmp(arg, "--prefetch") == 0;
+	});
+	if (last_arg != argv + argc) {
+		prefetch = true;
+		argc = last_arg - argv;
+	}
+
 	if (argc < 3) {
 		std::cerr << "Latency file and encoder needed" << std::endl;
 		exit(1);
@@ -923,7 +1023,7 @@ int main(int argc, char **argv)
 
 	// PHRASE DECODE TIME
 	std::cerr << "Measuring phrase decode time." << std::endl;
-	auto phrase_times = phrase_decode_time(encoder);
+	auto phrase_times = phrase_decode_time(encoder, prefetch);
 	reduce_tm(&phrase_times);
 
 	for (unsigned int dst_idx = 0; dst_idx < phrase_times.dsts.size(); dst_idx++) {
@@ -937,7 +1037,7 @@ int main(int argc, char **argv)
 	// LITERAL DECODE TIME
 	std::cerr << "Measuring literal decode time." << std::endl;
 	nanosecs_t lit_fix, lit_var;
-	std::tie(lit_fix, lit_var) = literal_decode_time(encoder);
+	std::tie(lit_fix, lit_var) = literal_decode_time(encoder, prefetch);
 	std::cerr << "Literal fix time = " << lit_fix.count() << ", var time = " << lit_var.count() << std::endl;
 
 
@@ -956,9 +1056,18 @@ int main(int argc, char **argv)
 	std::cerr << "Copy enter time = " << bmp_time.count() << " nsecs" << std::endl;
 
 	// LITERAL PENALTY TIME
-	auto lit_penalty_time = lit_pen_time(encoder, nanosecs_t(phrase_times.cm(0,0)), lit_fix);
+	auto lit_penalty_time = lit_pen_time(encoder, nanosecs_t(phrase_times.cm(0,0)), lit_fix, prefetch);
 	std::cerr << "Lit BMP time = " << lit_penalty_time.count() << std::endl;
 
+	// MEMORY LATENCY LEFT BY PREFETCHING
+	if (prefetch) {
+		auto factor = exposed_latency(encoder);
+		std::cerr << "Exposed latency = " << factor << std::endl;
+		for (auto &i : latencies) {
+			std::get<1>(i) *= factor;
+		}
+	}
+
 	// TODO: output model
 	std::cerr << "Output model into standard output" << std::endl;
 //	const size_t line_size = 64;
@@ -3,19 +3,21 @@
 if [ $# -lt 2 ]
 then
 	echo "ERROR: too few arguments"
-	echo "Usage: <output file> <latency file>"
+	echo "Usage: <output file> <latency file> [--prefetch]"
 	exit 1
 fi
 
 FILE="${1}.tgt"
 LATENCY="${2}"
-ENCODER_LIST="soda09_16 hybrid-16"
+# Models of the prefetching decoder (decompress --prefetch)
+MODE="${3}"
+ENCODER_LIST="soda09_16 hybrid-16 split-huff-16"
 
 rm -f ${FILE}
 
 for ENC in ${ENCODER_LIST}
 do
 	echo "== ${ENC}" | tee -a ${FILE}
-	taskset 0x1 ./calibrator ${LATENCY} ${ENC} | tee -a ${FILE}
+	taskset 0x1 ./calibrator ${LATENCY} ${ENC} ${MODE} | tee -a ${FILE}
 	echo "" >> ${FILE}
 done